@@ -0,0 +1,118 @@
+#include "atlas.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+////////////////////////////////////////////////////////////////////////////////
+//                              global vars
+////////////////////////////////////////////////////////////////////////////////
+
+// the outlines of set_atlas_glyphs one after another, as set_instance_edges has them,
+// a glyph is an instance of its range at the origin until an atlas places it
+std::vector<Edge>       g_atlas_edges;
+std::vector<Instance>   g_atlas_outlines;
+std::vector<VkExtent2D> g_atlas_extents;
+
+////////////////////////////////////////////////////////////////////////////////
+//                              funcs
+////////////////////////////////////////////////////////////////////////////////
+
+std::optional<std::vector<glm::uvec2>> pack_shelves(std::span<Glyph const> glyphs, VkExtent2D extent)
+{
+  // tall glyphs first, so every shelf is about as high as its glyphs
+  std::vector<uint32_t> order(glyphs.size());
+  std::iota(order.begin(), order.end(), 0u);
+  std::ranges::stable_sort(order, std::ranges::greater(), [&](uint32_t i) { return glyphs[i].extent.height; });
+
+  std::vector<glm::uvec2> origins(glyphs.size());
+  glm::uvec2 pos          = { 0, 0 };
+  uint32_t   shelf_height = 0;
+  for (auto i : order)
+  {
+    auto size = glyphs[i].extent;
+    if (pos.x + size.width > extent.width)
+    {
+      pos           = { 0, pos.y + shelf_height + atlas_padding };
+      shelf_height  = 0;
+    }
+    if (size.width > extent.width || pos.y + size.height > extent.height)
+      return std::nullopt;
+    origins[i]   = pos;
+    pos.x       += size.width + atlas_padding;
+    shelf_height = std::max(shelf_height, size.height);
+  }
+  return origins;
+}
+
+void set_atlas_glyphs(std::span<Glyph const> glyphs)
+{
+  g_atlas_edges.clear();
+  g_atlas_outlines.clear();
+  g_atlas_extents.clear();
+  for (auto const& glyph : glyphs)
+  {
+    g_atlas_outlines.push_back({ .first_edge = static_cast<uint32_t>(g_atlas_edges.size()), .edge_count = static_cast<uint32_t>(glyph.edges.size()) });
+    g_atlas_extents.push_back(glyph.extent);
+    g_atlas_edges.insert(g_atlas_edges.end(), glyph.edges.begin(), glyph.edges.end());
+  }
+  exit_if(g_atlas_edges.size() > UINT32_MAX);
+  set_instance_edges(g_atlas_edges);
+}
+
+std::optional<std::vector<UvRect>> rasterize_atlas(std::span<uint32_t const> glyph_ids, VkExtent2D extent)
+{
+  exit_if(g_windowed || g_retained);
+
+  // only the extents are packed, the outlines stay where set_atlas_glyphs put them
+  std::vector<Glyph> glyphs;
+  for (auto id : glyph_ids)
+  {
+    exit_if(id >= g_atlas_outlines.size());
+    glyphs.push_back({ .extent = g_atlas_extents[id] });
+  }
+  auto origins = pack_shelves(glyphs, extent);
+  if (!origins)
+    return std::nullopt;
+
+  // scene resources are sized for one extent
+  auto resize = g_wr_image.extent.width != extent.width || g_wr_image.extent.height != extent.height;
+  if (resize)
+    release_scene_resources();
+
+  // every glyph is an instance of its outline at its cell, coverage is linear in
+  // the edges and the cells do not overlap, so every pixel only sees its own glyph
+  auto size = glm::vec2(extent.width, extent.height);
+  std::vector<UvRect> rects(glyphs.size());
+  g_edges.clear();
+  g_layers.clear();
+  g_instances.clear();
+  for (size_t i = 0; i < glyphs.size(); ++i)
+  {
+    auto  origin   = glm::vec2((*origins)[i]);
+    auto& instance = g_instances.emplace_back(g_atlas_outlines[glyph_ids[i]]);
+    instance.origin = origin;
+    rects[i] = { origin / size, (origin + glm::vec2(glyphs[i].extent.width, glyphs[i].extent.height)) / size };
+  }
+
+  if (resize)
+    create_scene_resources(extent);
+  else
+    update_scene();
+  render_headless();
+  return rects;
+}
+
+std::vector<Edge> get_atlas_edges()
+{
+  std::vector<Edge> edges;
+  for (auto const& instance : g_instances)
+    for (auto edge : std::span(g_atlas_edges).subspan(instance.first_edge, instance.edge_count))
+    {
+      edge.p0 += instance.origin;
+      edge.p1 += instance.origin;
+      edge.p2 += instance.origin;
+      edge.p3 += instance.origin;
+      edges.push_back(edge);
+    }
+  return edges;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "renderer.hpp"
+
+#include <span>
+#include <optional>
+
+//
+// glyph atlas, packs glyph outlines into shelves of g_wr_image and
+// rasterizes all of them in one submission, every pass runs once for
+// the whole atlas instead of once per glyph
+//
+// the outlines are uploaded once by set_atlas_glyphs, an atlas only uploads
+// the cell origins of its glyphs as g_instances, bin.glsl and coefficients.glsl
+// move the edges there when they load them
+//
+
+// outline in pixel coordinates of its cell, origin at the top left
+struct Glyph
+{
+  std::span<Edge const> edges;
+  VkExtent2D            extent;
+};
+
+// normalized texture coordinates of a glyph cell in the atlas
+struct UvRect
+{
+  glm::vec2 min;
+  glm::vec2 max;
+};
+
+// pixels between cells, so bilinear sampling of a glyph never reaches its neighbours
+constexpr uint32_t atlas_padding = 1;
+
+// top left pixel of every glyph cell, cells are placed by decreasing height
+// on shelves filled left to right, nothing if they do not fit into extent
+std::optional<std::vector<glm::uvec2>> pack_shelves(std::span<Glyph const> glyphs, VkExtent2D extent);
+
+// uploads the outlines of the glyphs, rasterize_atlas refers to them by index,
+// replaces the glyphs of an earlier call
+void set_atlas_glyphs(std::span<Glyph const> glyphs);
+
+// headless only, g_wr_image becomes an atlas of extent holding the glyphs of
+// set_atlas_glyphs with these indices, nothing if they do not fit, a new extent
+// recreates the scene resources, readback_wr_image waits for the submission
+std::optional<std::vector<UvRect>> rasterize_atlas(std::span<uint32_t const> glyph_ids, VkExtent2D extent);
+
+// the edges of the last atlas moved into their cells, for the cpu reference
+std::vector<Edge> get_atlas_edges();
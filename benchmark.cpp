@@ -0,0 +1,421 @@
+#include "renderer.hpp"
+#include "cpu_rasterizer.hpp"
+
+#include <glm/gtc/constants.hpp>
+
+#include <print>
+#include <format>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <string>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <thread>
+
+//
+// headless benchmark of synthetic scenes over a sweep of output
+// resolutions and edge counts, results are written as json
+//
+
+////////////////////////////////////////////////////////////////////////////////
+//                              global vars
+////////////////////////////////////////////////////////////////////////////////
+
+uint32_t                    g_frame_count  = 100;
+uint32_t                    g_warmup_count = 10;
+std::vector<VkExtent2D>     g_resolutions  = { { 512, 512 }, { 1024, 1024 }, { 1920, 1080 }, { 3840, 2160 } };
+std::vector<uint32_t>       g_edge_counts  = { 1000, 10000, 100000 };
+std::string_view            g_output;
+std::string_view            g_format_name  = "rgba32f";
+bool                        g_cpu_backend;
+bool                        g_stream;
+uint32_t                    g_context_count;
+std::unique_ptr<Rasterizer> g_rasterizer;
+
+////////////////////////////////////////////////////////////////////////////////
+//                              scene funcs
+////////////////////////////////////////////////////////////////////////////////
+
+// the generators append shapes until at least edge_count edges exist,
+// shapes stay small so the tile lists of bin.glsl stay bounded
+
+float random_unit(std::mt19937& rng)
+{
+  return std::uniform_real_distribution<float>(0.f, 1.f)(rng);
+}
+
+glm::vec2 random_point(std::mt19937& rng, glm::vec2 size)
+{
+  return glm::vec2(random_unit(rng), random_unit(rng)) * size;
+}
+
+// self intersecting polygons of random points around a center
+void random_polygons(VkExtent2D extent, uint32_t edge_count, std::mt19937& rng)
+{
+  auto size = glm::vec2(extent.width, extent.height);
+  while (g_edges.size() < edge_count)
+  {
+    auto center = random_point(rng, size);
+    auto radius = glm::mix(4.f, 64.f, random_unit(rng));
+    std::vector<glm::vec2> points(std::uniform_int_distribution<uint32_t>(3, 12)(rng));
+    for (auto& point : points)
+      point = center + radius * (2.f * glm::vec2(random_unit(rng), random_unit(rng)) - 1.f);
+    add_polygon(points);
+  }
+}
+
+// lines of small quadratic glyphs, half of them with a counter,
+// the page starts over at the top once it is full
+void text_page(VkExtent2D extent, uint32_t edge_count, std::mt19937& rng)
+{
+  // loop of quadratics through the side midpoints, bent towards the corners
+  auto add_glyph = [&](glm::vec2 center, glm::vec2 radius, bool clockwise)
+  {
+    glm::vec2 sides[] = { { 1.f, 0.f }, { 0.f, 1.f }, { -1.f, 0.f }, { 0.f, -1.f } };
+    for (int i = 0; i < 4; ++i)
+    {
+      auto a    = sides[clockwise ? 3 - i : i];
+      auto b    = sides[clockwise ? (6 - i) % 4 : (i + 1) % 4];
+      auto bend = glm::mix(.5f, 1.f, random_unit(rng));
+      add_bezier<3>({ center + radius * a, center + radius * (a + b) * bend, center + radius * b });
+    }
+  };
+
+  auto glyph_size = glm::vec2(8.f, 12.f);
+  auto advance    = glm::vec2(10.f, 16.f);
+  auto pos        = advance * .5f;
+  while (g_edges.size() < edge_count)
+  {
+    add_glyph(pos, glyph_size * .5f, false);
+    if (random_unit(rng) < .5f)
+      add_glyph(pos, glyph_size * .25f, true);
+
+    pos.x += advance.x;
+    if (pos.x > extent.width)
+    {
+      pos.x  = advance.x * .5f;
+      pos.y += advance.y;
+    }
+    if (pos.y > extent.height)
+      pos.y = advance.y * .5f;
+  }
+}
+
+// large stars around the center of the image which overlap heavily,
+// point counts grow with the radius to keep the spikes short
+void stars(VkExtent2D extent, uint32_t edge_count, std::mt19937& rng)
+{
+  auto size = glm::vec2(extent.width, extent.height);
+  auto unit = std::min(size.x, size.y);
+  while (g_edges.size() < edge_count)
+  {
+    auto center = size * .5f + (random_point(rng, size) - size * .5f) * .25f;
+    auto radius = unit * glm::mix(.1f, .45f, random_unit(rng));
+    auto count  = std::max(5u, static_cast<uint32_t>(radius / 8.f));
+    auto inner  = radius * glm::mix(.7f, .9f, random_unit(rng));
+    add_polygon(regular_polygon(center, radius, inner, count * 2, random_unit(rng) < .5f));
+  }
+}
+
+// long thin triangles at random angles, mostly narrower than a pixel
+void slivers(VkExtent2D extent, uint32_t edge_count, std::mt19937& rng)
+{
+  auto size = glm::vec2(extent.width, extent.height);
+  while (g_edges.size() < edge_count)
+  {
+    auto angle  = 2.f * glm::pi<float>() * random_unit(rng);
+    auto dir    = glm::vec2(std::cos(angle), std::sin(angle));
+    auto length = glm::mix(16.f, 128.f, random_unit(rng));
+    auto width  = glm::mix(.25f, 1.5f, random_unit(rng));
+    auto beg    = random_point(rng, size);
+    auto end    = beg + dir * length;
+    add_polygon({ beg, end, end + glm::vec2(-dir.y, dir.x) * width });
+  }
+}
+
+struct Scene
+{
+  std::string_view name;
+  void           (*generate)(VkExtent2D extent, uint32_t edge_count, std::mt19937& rng);
+};
+
+std::vector<Scene> g_scenes =
+{
+  { "random_polygons", random_polygons },
+  { "text_page",       text_page       },
+  { "stars",           stars           },
+  { "slivers",         slivers         },
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//                              benchmark funcs
+////////////////////////////////////////////////////////////////////////////////
+
+struct Result
+{
+  std::string_view                  scene;
+  VkExtent2D                        extent;
+  size_t                            edge_count;
+  double                            ms_per_frame;
+  std::array<PassStats, pass_count> passes;
+};
+
+// render the scene in g_edges, the gpu uploads it first
+void measure_gpu(Result& result)
+{
+  create_scene_resources(result.extent);
+
+  // streaming uploads the edges anew every frame as a changing scene would
+  auto render = [&]
+  {
+    if (g_stream)
+      update_scene();
+    render_headless();
+  };
+
+  // warm up caches and clocks before measuring
+  for (uint32_t i = 0; i < g_warmup_count; ++i)
+    render();
+  check_vk(vkQueueWaitIdle(g_queue));
+  reset_pass_stats();
+
+  auto beg = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < g_frame_count; ++i)
+    render();
+  check_vk(vkQueueWaitIdle(g_queue));
+  auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - beg).count();
+  collect_pending_queries();
+
+  result.ms_per_frame = ms / g_frame_count;
+  for (uint32_t pass = 0; pass < pass_count; ++pass)
+    result.passes[pass] = get_pass_stats(static_cast<Pass>(pass));
+  release_scene_resources();
+}
+
+// every context renders the scene on a thread of its own, the jobs of all of them are
+// in flight at once, ms_per_frame is the wall time over the jobs of all contexts
+void measure_contexts(Result& result)
+{
+  std::deque<RenderContext> contexts;
+  for (uint32_t i = 0; i < g_context_count; ++i)
+    contexts.emplace_back(*g_rasterizer, result.extent, g_output_format);
+
+  auto render = [&](uint32_t job_count)
+  {
+    std::vector<std::thread> threads;
+    for (auto& context : contexts)
+      threads.emplace_back([&context, job_count]
+      {
+        uint64_t job = 0;
+        for (uint32_t i = 0; i < job_count; ++i)
+          job = context.submit(g_edges);
+        if (job)
+          context.wait(job);
+      });
+    for (auto& thread : threads)
+      thread.join();
+  };
+
+  render(g_warmup_count);
+  auto beg = std::chrono::steady_clock::now();
+  render(g_frame_count);
+  auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - beg).count();
+  result.ms_per_frame = ms / (static_cast<double>(g_frame_count) * g_context_count);
+  g_edges.clear();
+}
+
+void measure_cpu(Result& result)
+{
+  std::vector<float> pixels(static_cast<size_t>(result.extent.width) * result.extent.height * 4);
+  for (uint32_t i = 0; i < g_warmup_count; ++i)
+    rasterize_cpu(g_edges, result.extent, pixels.data());
+
+  auto beg = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < g_frame_count; ++i)
+    rasterize_cpu(g_edges, result.extent, pixels.data());
+  auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - beg).count();
+  result.ms_per_frame = ms / g_frame_count;
+  g_edges.clear();
+}
+
+auto run(Scene const& scene, VkExtent2D extent, uint32_t edge_count)
+{
+  // same scene for every run of a case
+  std::mt19937 rng(edge_count);
+  scene.generate(extent, edge_count, rng);
+  auto result = Result
+  {
+    .scene      = scene.name,
+    .extent     = extent,
+    .edge_count = g_edges.size(),
+  };
+  if (g_cpu_backend)
+    measure_cpu(result);
+  else if (g_context_count)
+    measure_contexts(result);
+  else
+    measure_gpu(result);
+  return result;
+}
+
+auto to_json(std::vector<Result> const& results)
+{
+  std::string device;
+  if (g_cpu_backend)
+    device = std::format("{} cpu threads", get_cpu_thread_count());
+  else
+  {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(g_physical_device, &properties);
+    device = properties.deviceName;
+  }
+
+  auto json = std::format("{{\n  \"backend\": \"{}\",\n  \"device\": \"{}\",\n  \"format\": \"{}\",\n  \"stream\": {},\n  \"contexts\": {},\n  \"frames\": {},\n  \"results\":\n  [",
+    g_cpu_backend ? "cpu" : "gpu", device, g_cpu_backend ? "rgba32f" : g_format_name, g_stream, g_context_count, g_frame_count);
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    auto const& result = results[i];
+    auto seconds       = result.ms_per_frame * 1e-3;
+    auto pixels        = static_cast<double>(result.extent.width) * result.extent.height;
+    json += std::format("{}\n    {{ \"scene\": \"{}\", \"width\": {}, \"height\": {}, \"edges\": {}, "
+                        "\"ms_per_frame\": {:.4f}, \"edges_per_second\": {:.0f}, \"mpixels_per_second\": {:.2f}",
+      i ? "," : "", result.scene, result.extent.width, result.extent.height, result.edge_count,
+      result.ms_per_frame, result.edge_count / seconds, pixels / seconds * 1e-6);
+
+    // the blit pass only exists with a swapchain, contexts do not profile
+    if (!g_cpu_backend && !g_context_count)
+    {
+      json += ", \"gpu_ms\": { ";
+      for (uint32_t pass = 0; pass < pass_blit; ++pass)
+      {
+        auto const& stats = result.passes[pass];
+        json += std::format("{}\"{}\": {{ \"min\": {:.4f}, \"avg\": {:.4f}, \"p99\": {:.4f} }}",
+          pass ? ", " : "", pass_names[pass], stats.min, stats.avg, stats.p99);
+      }
+      json += " }";
+    }
+    json += " }";
+  }
+  json += "\n  ]\n}\n";
+  return json;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                              main func
+////////////////////////////////////////////////////////////////////////////////
+
+// comma separated values
+template <typename T, typename F>
+auto parse_list(std::string_view str, F parse)
+{
+  std::vector<T> values;
+  while (!str.empty())
+  {
+    auto pos = str.find(',');
+    values.push_back(parse(str.substr(0, pos)));
+    str = pos == std::string_view::npos ? std::string_view() : str.substr(pos + 1);
+  }
+  exit_if(values.empty());
+  return values;
+}
+
+void parse_args(int argc, char** argv)
+{
+  auto usage = [&]
+  {
+    std::println("usage: {} [--frames <count>] [--warmup <count>] [--resolutions <width>x<height>,...] [--edges <count>,...] [--scenes <name>,...] [--backend <gpu|cpu>] [--format <r8|r16f|rgba8|rgba32f>] [--stream <0|1>] [--contexts <count>] [--output <file.json>]", argv[0]);
+    std::println("scenes: random_polygons, text_page, stars, slivers");
+    exit(1);
+  };
+
+  for (int i = 1; i < argc; ++i)
+  {
+    auto arg = std::string_view(argv[i]);
+    if (i + 1 >= argc)
+      usage();
+    auto value = std::string_view(argv[++i]);
+
+    if (arg == "--frames")
+    {
+      g_frame_count = parse_uint(value);
+      exit_if(!g_frame_count);
+    }
+    else if (arg == "--warmup")
+      g_warmup_count = parse_uint(value);
+    else if (arg == "--resolutions")
+      g_resolutions = parse_list<VkExtent2D>(value, parse_extent);
+    else if (arg == "--edges")
+      g_edge_counts = parse_list<uint32_t>(value, parse_uint);
+    else if (arg == "--scenes")
+    {
+      g_scenes = parse_list<Scene>(value, [&](std::string_view name)
+      {
+        auto it = std::ranges::find(g_scenes, name, &Scene::name);
+        if (it == g_scenes.end())
+          usage();
+        return *it;
+      });
+    }
+    else if (arg == "--backend")
+    {
+      if (value != "gpu" && value != "cpu")
+        usage();
+      g_cpu_backend = value == "cpu";
+    }
+    else if (arg == "--format")
+    {
+      g_output_format = parse_format(value);
+      g_format_name   = value;
+    }
+    else if (arg == "--stream")
+      g_stream = parse_uint(value);
+    else if (arg == "--contexts")
+      g_context_count = parse_uint(value);
+    else if (arg == "--output")
+      g_output = value;
+    else
+      usage();
+  }
+
+  // contexts rasterize on the gpu and upload every job anyway
+  if (g_context_count && (g_cpu_backend || g_stream))
+    usage();
+}
+
+int main(int argc, char** argv)
+{
+  parse_args(argc, argv);
+
+  // the cpu backend needs no vulkan device
+  if (!g_cpu_backend)
+  {
+    g_rasterizer = Rasterizer::create();
+    exit_if(!g_rasterizer);
+  }
+
+  std::vector<Result> results;
+  for (auto const& scene : g_scenes)
+    for (auto extent : g_resolutions)
+      for (auto edge_count : g_edge_counts)
+      {
+        results.push_back(run(scene, extent, edge_count));
+        auto const& result = results.back();
+        std::println(stderr, "{} {}x{} {} edges: {:.3f} ms/frame",
+          result.scene, extent.width, extent.height, result.edge_count, result.ms_per_frame);
+      }
+
+  auto json = to_json(results);
+  if (g_output.empty())
+    std::print("{}", json);
+  else
+  {
+    std::ofstream file(g_output.data());
+    exit_if(!file.is_open());
+    file << json;
+  }
+
+  g_rasterizer.reset();
+  return 0;
+}
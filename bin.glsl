@@ -0,0 +1,90 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_buffer_reference : require
+
+//
+// Tile binning, runs twice before coefficients.glsl with scan.glsl in
+// between.
+//
+// The count pass adds every edge to the count of each tile its part in a
+// tile row overlaps, and adds its height in that row to the backdrop of
+// the tiles left of it, in the fixed point of to_backdrop. The scatter pass walks the same tiles again and
+// writes the edge and tile index into the slot range scan.glsl reserved
+// for the tile.
+//
+// A tile only needs the edges overlapping it, because with the scaling
+// function clamp(x, 0, 1) in tile coordinates an edge fully left of the
+// tile contributes nothing and an edge fully right of it contributes just
+// its height inside the tile row.
+//
+// The tiles and backdrops are those of the layer of the edge, see Layer in
+// common.glsl, its bounds contain the part of the edge inside the image.
+//
+
+#include "common.glsl"
+
+layout(constant_id = 0) const bool scatter = false;
+
+layout(local_size_x = 256) in;
+
+void main()
+{
+  uint index = gl_GlobalInvocationID.x;
+  if (index >= edge_count) return;
+
+  // edge in tile units, it is monotone in x and y
+  Layer layer = layer_buffer.layers[find_layer(LAYER_EDGE, index)];
+  Poly  p     = to_local(to_poly(load_edge(index)), vec2(0.0), float(TILE_SIZE));
+  vec2  beg   = evaluate(p, 0.0);
+  vec2  end   = evaluate(p, 1.0);
+  bool  down  = end.y >= beg.y;
+  float y_min = min(beg.y, end.y);
+  float y_max = max(beg.y, end.y);
+
+  ivec2 tile_max = layer.tile_min + layer.tile_extent - 1;
+  int   row_beg  = max(int(floor(y_min)), layer.tile_min.y);
+  int   row_end  = min(int(ceil(y_max)) - 1, tile_max.y);
+  for (int row = row_beg; row <= row_end; ++row)
+  {
+    // parameter range of the part inside the row
+    float top    = float(row);
+    float bottom = float(row + 1);
+    float ta, tb;
+    if (down)
+    {
+      ta = beg.y >= top    ? 0.0 : solve(p, 1, top);
+      tb = end.y <= bottom ? 1.0 : solve(p, 1, bottom);
+    }
+    else
+    {
+      ta = beg.y <= bottom ? 0.0 : solve(p, 1, bottom);
+      tb = end.y >= top    ? 1.0 : solve(p, 1, top);
+    }
+    vec2 a = evaluate(p, ta);
+    vec2 b = evaluate(p, tb);
+    // the part ends at the row borders, not where the roots evaluate to
+    float ya = ta == 0.0 ? beg.y : down ? top : bottom;
+    float yb = tb == 1.0 ? end.y : down ? bottom : top;
+
+    int col_beg = int(floor(min(a.x, b.x)));
+    int col_end = min(int(floor(max(a.x, b.x))), tile_max.x);
+
+    // tiles left of the part see it fully on their right
+    ivec2 local = ivec2(clamp(col_beg - layer.tile_min.x, 0, layer.tile_extent.x), row - layer.tile_min.y);
+    if (!scatter)
+      atomicAdd(backdrop_buffer.backdrops[get_backdrop_index(layer, local)], to_backdrop(yb - top) - to_backdrop(ya - top));
+
+    for (int col = max(col_beg, layer.tile_min.x); col <= col_end; ++col)
+    {
+      uint tile = get_layer_tile(layer, ivec2(col, row) - layer.tile_min);
+      if (!scatter)
+        atomicAdd(tile_buffer.tiles[tile].count, 1u);
+      else
+      {
+        uint slot = atomicAdd(tile_buffer.tiles[tile].cursor, 1u);
+        if (slot < tile_edge_capacity)
+          tile_edge_buffer.tile_edges[slot] = TileEdge(index, tile);
+      }
+    }
+  }
+}
@@ -0,0 +1,239 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_shader_atomic_float : require
+#extension GL_EXT_buffer_reference : require
+#ifdef SUBGROUP_REDUCE
+#extension GL_KHR_shader_subgroup_basic : require
+#extension GL_KHR_shader_subgroup_arithmetic : require
+#extension GL_KHR_shader_subgroup_ballot : require
+#endif
+
+//
+// Coefficient generation, one invocation per entry of the tile lists.
+// Adds the contribution of the edge to the scaling coefficient of the
+// tile and to the detail coefficients of every cell of the tile quadtree
+// the edge passes through. shader.glsl reconstructs the pixels from the
+// blocks afterwards.
+//
+// The SUBGROUP_REDUCE variant sums the contributions of a workgroup before
+// they reach the block buffer. The scatter pass lists the entries of a tile
+// next to each other, so a workgroup covers a few runs of entries, and every
+// run gets a block in shared memory. The scaling and level 0 coefficients,
+// which every edge of the tile adds to, are summed across the subgroup
+// first. Dense tiles then see one global atomic per coefficient and
+// workgroup instead of one per edge. Runs past the shared blocks add to the
+// block buffer directly.
+//
+
+#include "common.glsl"
+#include "wavelet.glsl"
+
+layout(local_size_x = 256) in;
+
+// block the entry of the invocation adds to
+uint block;
+
+#ifdef SUBGROUP_REDUCE
+
+#define SLOT_COUNT 8u
+
+shared float s_blocks[SLOT_COUNT * BLOCK_SIZE];
+shared uint  s_slot_blocks[SLOT_COUNT];
+shared uint  s_slot_count;
+
+// shared block of the run of the invocation, -1 if there is none left
+int slot;
+
+void add(uint index, float value)
+{
+  if (value == 0.0)
+    return;
+  if (slot >= 0)
+    atomicAdd(s_blocks[slot * BLOCK_SIZE + index], value);
+  else
+    atomicAdd(block_buffer.blocks[block * BLOCK_SIZE + index], value);
+}
+
+#else
+
+void add(uint index, float value)
+{
+  if (value != 0.0)
+    atomicAdd(block_buffer.blocks[block * BLOCK_SIZE + index], value);
+}
+
+#endif
+
+// wavelet coefficients of the edge in a cell of the tile quadtree, false if it misses the cell
+bool cell_coefficients(Poly curve, bool is_line, vec2 beg, vec2 end, int level, ivec2 cell, out vec3 c)
+{
+  int cells = 1 << level;
+  if (is_line)
+  {
+    vec2 p0 = beg * cells - vec2(cell);
+    vec2 p1 = end * cells - vec2(cell);
+    if (!clip(p0, p1)) return false;
+    c = wavelet_coefficients(p0, p1);
+    return true;
+  }
+  return curve_wavelet_coefficients(to_local(curve, vec2(cell) / cells, 1.0 / cells), c);
+}
+
+// parameter where the monotone edge reaches y, clamped to its end points
+float get_parameter(Poly curve, vec2 beg, vec2 end, float y)
+{
+  if (y <= min(beg.y, end.y)) return beg.y < end.y ? 0.0 : 1.0;
+  if (y >= max(beg.y, end.y)) return beg.y < end.y ? 1.0 : 0.0;
+  return solve(curve, 1, y);
+}
+
+// detail coefficients of the cells the edge passes through on levels first_level
+// to levels - 1, cells it misses have none, so the quadtree is only descended
+// along the edge and the work grows with its length instead of its bounds
+void add_details(Poly curve, bool is_line, vec2 beg, vec2 end, int first_level, int levels)
+{
+  // monotone edges lie inside the bounds of their end points, in every row
+  // of cells between their x at the top and at the bottom of the row
+  vec2 lo = clamp(min(beg, end), 0.0, 1.0);
+  vec2 hi = clamp(max(beg, end), 0.0, 1.0);
+  for (int level = first_level; level < levels; ++level)
+  {
+    int cells   = 1 << level;
+    int row_beg = min(int(lo.y * cells), cells - 1);
+    int row_end = min(int(hi.y * cells), cells - 1);
+    for (int y = row_beg; y <= row_end; ++y)
+    {
+      float xa = evaluate(curve, get_parameter(curve, beg, end, float(y) / cells)).x;
+      float xb = evaluate(curve, get_parameter(curve, beg, end, float(y + 1) / cells)).x;
+      // newton steps of solve may end a little short of the cell boundary
+      int col_beg = clamp(int(floor((min(xa, xb) - 1e-4) * cells)), 0, cells - 1);
+      int col_end = clamp(int(floor((max(xa, xb) + 1e-4) * cells)), 0, cells - 1);
+      for (int x = col_beg; x <= col_end; ++x)
+      {
+        vec3 c;
+        if (!cell_coefficients(curve, is_line, beg, end, level, ivec2(x, y), c))
+          continue;
+
+        uint i = coefficient_index(level, ivec2(x, y));
+        add(i + 0, c.x);
+        add(i + 1, c.y);
+        add(i + 2, c.z);
+      }
+    }
+  }
+}
+
+// edge of a tile list entry in tile coordinates and the number of levels it has details on
+Poly get_local_curve(TileEdge entry, out bool is_line, out int levels)
+{
+  Layer layer    = layer_buffer.layers[find_layer(LAYER_EDGE, entry.edge)];
+  uint  offset   = entry.tile - layer.first_tile;
+  ivec2 tile_id  = layer.tile_min + ivec2(offset % layer.tile_extent.x, offset / layer.tile_extent.x);
+  vec2  tile_pos = vec2(tile_id * TILE_SIZE);
+  Edge  edge     = load_edge(entry.edge);
+  is_line = edge.type == EDGE_LINE;
+  levels  = TILE_LEVELS - int(min(edge.coarse_levels, uint(TILE_LEVELS)));
+  return to_local(to_poly(edge), tile_pos, float(TILE_SIZE));
+}
+
+#ifndef SUBGROUP_REDUCE
+
+void main()
+{
+  uint index = gl_GlobalInvocationID.x;
+  if (index >= counter_buffer.counters.tile_edge_count) return;
+
+  TileEdge entry = tile_edge_buffer.tile_edges[index];
+  block = tile_buffer.tiles[entry.tile].block;
+  if (block == NO_BLOCK) return;
+
+  bool is_line;
+  int  levels;
+  Poly curve = get_local_curve(entry, is_line, levels);
+  vec2 beg   = evaluate(curve, 0.0);
+  vec2 end   = evaluate(curve, 1.0);
+  add(0, is_line ? scaling_coefficient(beg, end) : curve_scaling_coefficient(curve));
+  add_details(curve, is_line, beg, end, 0, levels);
+}
+
+#else
+
+void main()
+{
+  // no invocation returns early, the barriers and the ballot need all of them
+  uint index = gl_GlobalInvocationID.x;
+  uint local = gl_LocalInvocationIndex;
+  for (uint i = local; i < SLOT_COUNT * BLOCK_SIZE; i += gl_WorkGroupSize.x)
+    s_blocks[i] = 0.0;
+  if (local == 0)
+    s_slot_count = 0;
+
+  TileEdge entry;
+  block = NO_BLOCK;
+  if (index < counter_buffer.counters.tile_edge_count)
+  {
+    entry = tile_edge_buffer.tile_edges[index];
+    block = tile_buffer.tiles[entry.tile].block;
+  }
+  bool valid = block != NO_BLOCK;
+  barrier();
+
+  // an entry starts a run unless the one before adds to the same block,
+  // a subgroup reserves the slots of all runs it starts at once
+  bool  start  = valid && (local == 0 || tile_buffer.tiles[tile_edge_buffer.tile_edges[index - 1].tile].block != block);
+  uvec4 starts = subgroupBallot(start);
+  uint  first  = 0;
+  if (subgroupElect())
+    first = atomicAdd(s_slot_count, subgroupBallotBitCount(starts));
+  first = subgroupBroadcastFirst(first);
+  if (start && first + subgroupBallotExclusiveBitCount(starts) < SLOT_COUNT)
+    s_slot_blocks[first + subgroupBallotExclusiveBitCount(starts)] = block;
+  barrier();
+
+  uint slot_count = min(s_slot_count, SLOT_COUNT);
+  slot = -1;
+  for (uint i = 0; i < slot_count; ++i)
+    if (s_slot_blocks[i] == block)
+      slot = int(i);
+
+  if (valid)
+  {
+    bool is_line;
+    int  levels;
+    Poly curve = get_local_curve(entry, is_line, levels);
+    vec2 beg   = evaluate(curve, 0.0);
+    vec2 end   = evaluate(curve, 1.0);
+
+    // level 0 is the single cell of the tile
+    vec3 c;
+    vec4 level0 = vec4(is_line ? scaling_coefficient(beg, end) : curve_scaling_coefficient(curve), 0.0, 0.0, 0.0);
+    if (levels > 0 && cell_coefficients(curve, is_line, beg, end, 0, ivec2(0), c))
+      level0.yzw = c;
+
+    // the lanes of one block at a time sum their level 0 coefficients, one of them adds the sums
+    while (true)
+    {
+      if (block == subgroupBroadcastFirst(block))
+      {
+        vec4 sum = subgroupAdd(level0);
+        if (subgroupElect())
+          for (uint i = 0; i < 4; ++i)
+            add(i, sum[i]);
+        break;
+      }
+    }
+    add_details(curve, is_line, beg, end, 1, levels);
+  }
+  barrier();
+
+  // one global add per coefficient of each shared block
+  for (uint s = 0; s < slot_count; ++s)
+    for (uint i = local; i < BLOCK_SIZE; i += gl_WorkGroupSize.x)
+    {
+      float value = s_blocks[s * BLOCK_SIZE + i];
+      if (value != 0.0)
+        atomicAdd(block_buffer.blocks[s_slot_blocks[s] * BLOCK_SIZE + i], value);
+    }
+}
+
+#endif
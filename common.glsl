@@ -0,0 +1,299 @@
+//
+// Declarations shared by the binning and rasterization kernels.
+//
+
+#define EDGE_LINE      0
+#define EDGE_QUADRATIC 1
+#define EDGE_CUBIC     2
+
+// lines use p0 and p1, quadratics p0 to p2 and cubics all four points,
+// the edges of small contours skip the coarse_levels finest quadtree levels
+struct Edge
+{
+  vec2 p0;
+  vec2 p1;
+  vec2 p2;
+  vec2 p3;
+  uint type;
+  uint coarse_levels;
+};
+
+// a tile is the 16x16 pixel cell handled by one workgroup of shader.glsl,
+// edges of a layer overlapping it are listed in tile_edges[offset, offset + count)
+// of the tile of the layer
+#define TILE_SIZE   16
+#define TILE_LEVELS 4
+
+// tiles without edges have no coefficient block
+#define NO_BLOCK 0xffffffff
+
+struct Tile
+{
+  uint offset;
+  uint count;
+  uint cursor;
+  uint block;
+};
+
+struct TileEdge
+{
+  uint edge;
+  uint tile;
+};
+
+// A layer is a range of edges filled with a paint. Its tiles are those of
+// its bounds, tile_extent tiles from tile_min, stored row by row from
+// first_tile on, its backdrops have an extra column per row and start at
+// first_tile + first_row. Without layers the scene is a single layer over
+// the whole image, whose tiles are the tiles of the image.
+#define PAINT_SOLID  0
+#define PAINT_LINEAR 1
+#define PAINT_RADIAL 2
+
+struct Layer
+{
+  vec4  color0;
+  vec4  color1;
+  vec2  p0;
+  vec2  p1;
+  uint  paint_type;
+  uint  first_edge;
+  uint  first_tile;
+  uint  first_row;
+  ivec2 tile_min;
+  ivec2 tile_extent;
+};
+
+// the tiles of the layers covering a tile of the image, listed in
+// layer_list[offset, offset + count) in no particular order
+struct TileLayers
+{
+  uint offset;
+  uint count;
+  uint cursor;
+};
+
+// An instance places the edges from first_edge on at origin. The edges of
+// an instanced batch are numbered across its instances, those of instance
+// i from first_index on, so the glyphs of an atlas are uploaded once and
+// every atlas only uploads where they go, see load_edge.
+struct Instance
+{
+  vec2 origin;
+  uint first_edge;
+  uint first_index;
+};
+
+// written by scan.glsl, the groups are the indirect dispatch arguments
+// of coefficients.glsl and shader.glsl
+struct Counters
+{
+  uint  tile_edge_count;
+  uint  block_count;
+  uint  coefficient_groups[3];
+  uint  reconstruct_groups[3];
+  ivec2 reconstruct_origin;
+};
+
+// The kernels reach every buffer through a device address pushed with the
+// dispatch, matching PushConstants in renderer.cpp, so scenes can switch
+// buffers without touching a descriptor. Only the image is bound.
+layout(buffer_reference, std430) buffer EdgeBuffer      { Edge       edges[];       };
+layout(buffer_reference, std430) buffer TileBuffer      { Tile       tiles[];       };
+layout(buffer_reference, std430) buffer TileEdgeBuffer  { TileEdge   tile_edges[];  };
+// one extra column per row of a layer for edges right of its bounds,
+// scan.glsl turns the deltas bin.glsl adds into suffix sums along the row,
+// fixed point, see to_backdrop
+layout(buffer_reference, std430) buffer BackdropBuffer  { int        backdrops[];   };
+layout(buffer_reference, std430) buffer CounterBuffer   { Counters   counters;      };
+layout(buffer_reference, std430) buffer BlockBuffer     { float      blocks[];      };
+// tiles shader.glsl reconstructs when only part of a retained scene changed
+layout(buffer_reference, std430) buffer DirtyTileBuffer { uint       dirty_tiles[]; };
+layout(buffer_reference, std430) buffer LayerBuffer     { Layer      layers[];      };
+layout(buffer_reference, std430) buffer TileLayerBuffer { TileLayers tile_layers[]; };
+// shader.glsl sorts the lists of its tile in place
+layout(buffer_reference, std430) coherent buffer LayerListBuffer { uint layer_list[]; };
+layout(buffer_reference, std430) buffer InstanceBuffer  { uint instance_count; Instance instances[]; };
+
+// Retained scenes give every tile a block and keep the blocks and the tile
+// backdrops across frames. Accumulating frames add the edges of the changed
+// paths to them, removed paths come back reversed and cancel themselves.
+#define FLAG_RETAINED   1
+#define FLAG_ACCUMULATE 2
+// shader.glsl blends the layers of a tile instead of storing coverage
+#define FLAG_COMPOSITE  4
+// the edges are placed by instance_buffer
+#define FLAG_INSTANCED  8
+
+layout(push_constant) uniform PushConstants
+{
+  EdgeBuffer      edge_buffer;
+  TileBuffer      tile_buffer;
+  TileEdgeBuffer  tile_edge_buffer;
+  BackdropBuffer  backdrop_buffer;
+  CounterBuffer   counter_buffer;
+  BlockBuffer     block_buffer;
+  BackdropBuffer  tile_backdrop_buffer;
+  DirtyTileBuffer dirty_tile_buffer;
+  LayerBuffer     layer_buffer;
+  TileLayerBuffer tile_layer_buffer;
+  LayerListBuffer layer_list_buffer;
+  InstanceBuffer  instance_buffer;
+  ivec2           tile_count;
+  uint            edge_count;
+  uint            tile_edge_capacity;
+  uint            block_capacity;
+  uint            dirty_tile_count;
+  uint            flags;
+  uint            layer_count;
+};
+
+// edge index of the batch, instanced batches read the edge of the instance
+// it belongs to and move it to the origin of the instance
+Edge load_edge(uint index)
+{
+  if ((flags & FLAG_INSTANCED) == 0)
+    return edge_buffer.edges[index];
+
+  uint lo = 0;
+  uint hi = instance_buffer.instance_count;
+  while (hi - lo > 1)
+  {
+    uint mid = (lo + hi) / 2;
+    if (instance_buffer.instances[mid].first_index <= index) lo = mid;
+    else                                                     hi = mid;
+  }
+  Instance instance = instance_buffer.instances[lo];
+  Edge     edge     = edge_buffer.edges[instance.first_edge + index - instance.first_index];
+  edge.p0 += instance.origin;
+  edge.p1 += instance.origin;
+  edge.p2 += instance.origin;
+  edge.p3 += instance.origin;
+  return edge;
+}
+
+#define LAYER_EDGE 0
+#define LAYER_TILE 1
+#define LAYER_ROW  2
+
+// layer of an edge, a tile or a backdrop row, layers without any come
+// before the next one with the same first index
+uint find_layer(int key, uint value)
+{
+  uint lo = 0;
+  uint hi = layer_count;
+  while (hi - lo > 1)
+  {
+    uint mid   = (lo + hi) / 2;
+    uint first = key == LAYER_EDGE ? layer_buffer.layers[mid].first_edge
+               : key == LAYER_TILE ? layer_buffer.layers[mid].first_tile
+               :                     layer_buffer.layers[mid].first_row;
+    if (first <= value) lo = mid;
+    else                hi = mid;
+  }
+  return lo;
+}
+
+// tiles and backdrop rows of all layers
+uvec2 get_layer_totals()
+{
+  Layer last = layer_buffer.layers[layer_count - 1];
+  return uvec2(last.first_tile + uint(last.tile_extent.x * last.tile_extent.y), last.first_row + uint(last.tile_extent.y));
+}
+
+// tile of a layer from its position in the bounds of the layer
+uint get_layer_tile(Layer layer, ivec2 local)
+{
+  return layer.first_tile + uint(local.y * layer.tile_extent.x + local.x);
+}
+
+// backdrop of a tile of a layer, local.x goes up to tile_extent.x for the extra column
+uint get_backdrop_index(Layer layer, ivec2 local)
+{
+  return layer.first_tile + layer.first_row + uint(local.y * (layer.tile_extent.x + 1) + local.x);
+}
+
+// Backdrops are fixed point with BACKDROP_SCALE steps per tile height, so
+// bin.glsl adds them with int atomics, which need no extension, and the
+// sums do not depend on the order of the additions. The limit is a winding
+// number of 2^31 / BACKDROP_SCALE, intermediate sums may wrap.
+#define BACKDROP_SCALE 16384.0
+
+// y in a tile row, parts of edges which meet at a point round it alike, so
+// the heights of a closed contour cancel exactly
+int to_backdrop(float y)
+{
+  return int(round(y * BACKDROP_SCALE));
+}
+
+float from_backdrop(int backdrop)
+{
+  return float(backdrop) / BACKDROP_SCALE;
+}
+
+// Coefficients of a tile quadtree are stored in a block of 4^TILE_LEVELS
+// floats, only tiles with edges get one. Index 0 is the scaling coefficient
+// of the edges in the tile, the backdrop is kept apart. Level l starts at
+// 4^l and stores dx, dy, dxy for each of its 2^l x 2^l cells row by row.
+#define BLOCK_SIZE 256
+
+uint coefficient_index(int level, ivec2 cell)
+{
+  return (1u << (2 * level)) + 3u * uint(cell.y * (1 << level) + cell.x);
+}
+
+// power basis of a Bezier segment, P(t) = c0 + c1 t + c2 t^2 + c3 t^3
+struct Poly
+{
+  vec2 c0;
+  vec2 c1;
+  vec2 c2;
+  vec2 c3;
+};
+
+Poly to_poly(Edge edge)
+{
+  if (edge.type == EDGE_LINE)
+    return Poly(edge.p0, edge.p1 - edge.p0, vec2(0.0), vec2(0.0));
+  if (edge.type == EDGE_QUADRATIC)
+    return Poly(edge.p0, 2.0 * (edge.p1 - edge.p0), edge.p0 - 2.0 * edge.p1 + edge.p2, vec2(0.0));
+  return Poly(edge.p0, 3.0 * (edge.p1 - edge.p0), 3.0 * (edge.p0 - 2.0 * edge.p1 + edge.p2), edge.p3 - edge.p0 + 3.0 * (edge.p1 - edge.p2));
+}
+
+// map a curve into the local coordinates of a cell
+Poly to_local(Poly p, vec2 origin, float size)
+{
+  return Poly((p.c0 - origin) / size, p.c1 / size, p.c2 / size, p.c3 / size);
+}
+
+vec2 evaluate(Poly p, float t)
+{
+  return p.c0 + t * (p.c1 + t * (p.c2 + t * p.c3));
+}
+
+vec2 derivative(Poly p, float t)
+{
+  return p.c1 + t * (2.0 * p.c2 + t * 3.0 * p.c3);
+}
+
+// parameter where a monotone coordinate reaches value, -1 if not inside (0, 1)
+float solve(Poly p, int axis, float value)
+{
+  float f0 = p.c0[axis] - value;
+  float f1 = p.c0[axis] + p.c1[axis] + p.c2[axis] + p.c3[axis] - value;
+  if (f0 * f1 >= 0.0) return -1.0;
+
+  // newton iterations kept inside the bracket, bisect when they leave it
+  float lo = 0.0;
+  float hi = 1.0;
+  float t  = f0 / (f0 - f1);
+  for (int i = 0; i < 8; ++i)
+  {
+    float f = evaluate(p, t)[axis] - value;
+    if ((f < 0.0) == (f0 < 0.0)) lo = t;
+    else                         hi = t;
+    float next = t - f / derivative(p, t)[axis];
+    t = next >= lo && next <= hi ? next : 0.5 * (lo + hi);
+  }
+  return t;
+}
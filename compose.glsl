@@ -0,0 +1,83 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_buffer_reference : require
+
+//
+// Layer lists of the tiles of the image when compositing, runs between
+// scan.glsl, which counted the layers which are not empty in every tile,
+// and shader.glsl.
+//
+// The first pass is a single workgroup turning the counts into offsets
+// with an exclusive prefix sum. The scatter pass writes every tile of a
+// layer which has edges or a backdrop into the list of the tile of the
+// image it covers. The lists come out in no particular order, shader.glsl
+// sorts them back to front.
+//
+
+#include "common.glsl"
+
+#define GROUP_SIZE 256
+
+layout(constant_id = 0) const bool scatter = false;
+
+layout(local_size_x = GROUP_SIZE) in;
+
+shared uint sums[GROUP_SIZE];
+
+void scan_counts()
+{
+  // every invocation sums a contiguous chunk of tiles
+  uint tile_total = uint(tile_count.x * tile_count.y);
+  uint id         = gl_LocalInvocationIndex;
+  uint chunk      = (tile_total + GROUP_SIZE - 1) / GROUP_SIZE;
+  uint beg        = min(id * chunk, tile_total);
+  uint end        = min(beg + chunk, tile_total);
+  uint sum        = 0;
+  for (uint i = beg; i < end; ++i)
+    sum += tile_layer_buffer.tile_layers[i].count;
+
+  // inclusive scan of the chunk sums
+  sums[id] = sum;
+  barrier();
+  for (uint offset = 1; offset < GROUP_SIZE; offset <<= 1)
+  {
+    uint value = id >= offset ? sums[id - offset] : 0;
+    barrier();
+    sums[id] += value;
+    barrier();
+  }
+
+  // write exclusive offsets, the cursor is advanced by the scatter pass
+  uint offset = sums[id] - sum;
+  for (uint i = beg; i < end; ++i)
+  {
+    tile_layer_buffer.tile_layers[i].offset = offset;
+    tile_layer_buffer.tile_layers[i].cursor = offset;
+    offset += tile_layer_buffer.tile_layers[i].count;
+  }
+}
+
+void scatter_tiles()
+{
+  uint index = gl_GlobalInvocationID.x;
+  if (index >= get_layer_totals().x) return;
+
+  // the same test as in scan.glsl
+  Layer layer  = layer_buffer.layers[find_layer(LAYER_TILE, index)];
+  uint  offset = index - layer.first_tile;
+  ivec2 local  = ivec2(offset % layer.tile_extent.x, offset / layer.tile_extent.x);
+  if (tile_buffer.tiles[index].count == 0 && backdrop_buffer.backdrops[get_backdrop_index(layer, local)] == 0)
+    return;
+
+  ivec2 tile = layer.tile_min + local;
+  uint  slot = atomicAdd(tile_layer_buffer.tile_layers[tile.y * tile_count.x + tile.x].cursor, 1u);
+  layer_list_buffer.layer_list[slot] = index;
+}
+
+void main()
+{
+  if (scatter)
+    scatter_tiles();
+  else
+    scan_counts();
+}
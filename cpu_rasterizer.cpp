@@ -0,0 +1,464 @@
+#include "cpu_rasterizer.hpp"
+#include "scheduler.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+////////////////////////////////////////////////////////////////////////////////
+//                              global vars
+////////////////////////////////////////////////////////////////////////////////
+
+// tile lists as in bin.glsl, the edges of tile i are
+// g_cpu_tile_edges[g_cpu_tile_offsets[i], g_cpu_tile_offsets[i + 1])
+std::vector<uint32_t> g_cpu_tile_offsets;
+std::vector<uint32_t> g_cpu_tile_cursors;
+std::vector<uint32_t> g_cpu_tile_edges;
+std::vector<float>    g_cpu_backdrops;
+
+////////////////////////////////////////////////////////////////////////////////
+//                              simd
+////////////////////////////////////////////////////////////////////////////////
+
+// neighbouring cells of a quadtree row are evaluated side by side,
+// one cell per lane of simd.hpp
+
+inline Lanes clamp01(Lanes a)
+{
+  return min(max(a, splat(0.f)), splat(1.f));
+}
+
+// clip of wavelet.glsl per lane, lanes with nothing left are cleared in valid
+void clip(Lanes& p0x, Lanes& p0y, Lanes& p1x, Lanes& p1y, Mask& valid)
+{
+  auto zero  = splat(0.f);
+  auto dx    = p1x - p0x;
+  auto dy    = p1y - p0y;
+  auto t0    = zero;
+  auto t1    = splat(1.f);
+  Lanes p[4] = { zero - dx, dx, zero - dy, dy };
+  Lanes q[4] = { p0x, splat(1.f) - p0x, p0y, splat(1.f) - p0y };
+  for (int i = 0; i < 4; ++i)
+  {
+    // the quotient is only used where p is not zero
+    auto t = q[i] / p[i];
+    t0     = select(p[i] < zero, max(t0, t), t0);
+    t1     = select(p[i] > zero, min(t1, t), t1);
+    valid  = valid & !((p[i] == zero) & (q[i] < zero));
+  }
+  valid = valid & (t0 < t1);
+
+  p1x = p0x + t1 * dx;
+  p1y = p0y + t1 * dy;
+  p0x = p0x + t0 * dx;
+  p0y = p0y + t0 * dy;
+}
+
+// wavelet_coefficients of wavelet.glsl per lane
+void wavelet_coefficients(Lanes p0x, Lanes p0y, Lanes p1x, Lanes p1y, Lanes (&c)[3])
+{
+  auto zero  = splat(0.f);
+  auto half  = splat(.5f);
+  auto one   = splat(1.f);
+  auto dx    = p1x - p0x;
+  auto dy    = p1y - p0y;
+  auto tx    = select(dx == zero, zero, clamp01((half - p0x) / dx));
+  auto ty    = select(dy == zero, zero, clamp01((half - p0y) / dy));
+  Lanes ts[] = { zero, min(tx, ty), max(tx, ty), one };
+
+  c[0] = c[1] = c[2] = zero;
+  for (int i = 0; i < 3; ++i)
+  {
+    auto q0x    = p0x + ts[i] * dx;
+    auto q0y    = p0y + ts[i] * dy;
+    auto q1x    = p0x + ts[i + 1] * dx;
+    auto q1y    = p0y + ts[i + 1] * dy;
+    auto mx     = half * (q0x + q1x);
+    auto my     = half * (q0y + q1y);
+    auto sy     = select(my < half, one, zero - one);
+    auto tent_x = select(mx < half, mx, one - mx);
+    auto tent_y = select(my < half, my, one - my);
+    c[0] = c[0] + (q1y - q0y) * tent_x;
+    c[1] = c[1] - (q1x - q0x) * tent_y;
+    c[2] = c[2] + (q1y - q0y) * tent_x * sy;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                              curves
+////////////////////////////////////////////////////////////////////////////////
+
+// scalar ports of common.glsl and wavelet.glsl
+
+struct Poly
+{
+  glm::vec2 c0;
+  glm::vec2 c1;
+  glm::vec2 c2;
+  glm::vec2 c3;
+};
+
+Poly to_poly(Edge const& edge)
+{
+  if (edge.type == EdgeType::line)
+    return { edge.p0, edge.p1 - edge.p0, glm::vec2(0.f), glm::vec2(0.f) };
+  if (edge.type == EdgeType::quadratic)
+    return { edge.p0, 2.f * (edge.p1 - edge.p0), edge.p0 - 2.f * edge.p1 + edge.p2, glm::vec2(0.f) };
+  return { edge.p0, 3.f * (edge.p1 - edge.p0), 3.f * (edge.p0 - 2.f * edge.p1 + edge.p2), edge.p3 - edge.p0 + 3.f * (edge.p1 - edge.p2) };
+}
+
+Poly to_local(Poly const& p, glm::vec2 origin, float size)
+{
+  return { (p.c0 - origin) / size, p.c1 / size, p.c2 / size, p.c3 / size };
+}
+
+glm::vec2 evaluate(Poly const& p, float t)
+{
+  return p.c0 + t * (p.c1 + t * (p.c2 + t * p.c3));
+}
+
+glm::vec2 derivative(Poly const& p, float t)
+{
+  return p.c1 + t * (2.f * p.c2 + t * 3.f * p.c3);
+}
+
+float solve(Poly const& p, int axis, float value)
+{
+  auto f0 = p.c0[axis] - value;
+  auto f1 = p.c0[axis] + p.c1[axis] + p.c2[axis] + p.c3[axis] - value;
+  if (f0 * f1 >= 0.f) return -1.f;
+
+  auto lo = 0.f;
+  auto hi = 1.f;
+  auto t  = f0 / (f0 - f1);
+  for (int i = 0; i < 8; ++i)
+  {
+    auto f = evaluate(p, t)[axis] - value;
+    if ((f < 0.f) == (f0 < 0.f)) lo = t;
+    else                         hi = t;
+    auto next = t - f / derivative(p, t)[axis];
+    t = next >= lo && next <= hi ? next : .5f * (lo + hi);
+  }
+  return t;
+}
+
+int breakpoints(Poly const& p, glm::vec3 values, int value_count, float (&ts)[8])
+{
+  int count = 0;
+  ts[count++] = 0.f;
+  for (int axis = 0; axis < 2; ++axis)
+    for (int i = 0; i < value_count; ++i)
+    {
+      auto t = solve(p, axis, values[i]);
+      if (t > 0.f) ts[count++] = t;
+    }
+  ts[count++] = 1.f;
+  std::sort(ts, ts + count);
+  return count;
+}
+
+constexpr float gauss_nodes[3]   = { .1127016654f, .5f, .8872983346f };
+constexpr float gauss_weights[3] = { .2777777778f, .4444444444f, .2777777778f };
+
+float scaling_coefficient(glm::vec2 p0, glm::vec2 p1)
+{
+  auto d = p1 - p0;
+  if (d.y == 0.f) return 0.f;
+
+  auto t0 = std::clamp((0.f - p0.y) / d.y, 0.f, 1.f);
+  auto t1 = std::clamp((1.f - p0.y) / d.y, 0.f, 1.f);
+  if (t0 > t1) std::swap(t0, t1);
+
+  float ts[4] = { t0, t0, t1, t1 };
+  if (d.x != 0.f)
+  {
+    auto a = std::clamp((0.f - p0.x) / d.x, t0, t1);
+    auto b = std::clamp((1.f - p0.x) / d.x, t0, t1);
+    ts[1]  = std::min(a, b);
+    ts[2]  = std::max(a, b);
+  }
+
+  auto c = 0.f;
+  for (int i = 0; i < 3; ++i)
+  {
+    auto q0 = p0 + ts[i] * d;
+    auto q1 = p0 + ts[i + 1] * d;
+    c += (q1.y - q0.y) * std::clamp(.5f * (q0.x + q1.x), 0.f, 1.f);
+  }
+  return c;
+}
+
+float curve_scaling_coefficient(Poly const& p)
+{
+  float ts[8];
+  auto count = breakpoints(p, { 0.f, 1.f, 0.f }, 2, ts);
+
+  auto c = 0.f;
+  for (int i = 0; i + 1 < count; ++i)
+  {
+    auto dt = ts[i + 1] - ts[i];
+    auto m  = evaluate(p, ts[i] + .5f * dt);
+    if (dt <= 0.f || m.y < 0.f || m.y > 1.f || m.x < 0.f) continue;
+
+    for (int k = 0; k < 3; ++k)
+    {
+      auto t = ts[i] + gauss_nodes[k] * dt;
+      auto x = m.x > 1.f ? 1.f : evaluate(p, t).x;
+      c += gauss_weights[k] * dt * x * derivative(p, t).y;
+    }
+  }
+  return c;
+}
+
+bool curve_wavelet_coefficients(Poly const& p, glm::vec3& c)
+{
+  float ts[8];
+  auto count = breakpoints(p, { 0.f, .5f, 1.f }, 3, ts);
+
+  c = glm::vec3(0.f);
+  auto hit = false;
+  for (int i = 0; i + 1 < count; ++i)
+  {
+    auto dt = ts[i + 1] - ts[i];
+    auto m  = evaluate(p, ts[i] + .5f * dt);
+    if (dt <= 0.f || m.x < 0.f || m.y < 0.f || m.x > 1.f || m.y > 1.f) continue;
+    hit = true;
+
+    auto sy = m.y < .5f ? 1.f : -1.f;
+    for (int k = 0; k < 3; ++k)
+    {
+      auto t  = ts[i] + gauss_nodes[k] * dt;
+      auto q  = evaluate(p, t);
+      auto d  = derivative(p, t) * gauss_weights[k] * dt;
+      auto tx = m.x < .5f ? q.x : 1.f - q.x;
+      auto ty = m.y < .5f ? q.y : 1.f - q.y;
+      c.x += tx * d.y;
+      c.y -= ty * d.x;
+      c.z += tx * d.y * sy;
+    }
+  }
+  return hit;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                              rasterization
+////////////////////////////////////////////////////////////////////////////////
+
+uint32_t get_cpu_thread_count()
+{
+  return get_scheduler().thread_count();
+}
+
+uint32_t coefficient_index(int level, glm::ivec2 cell)
+{
+  return (1u << (2 * level)) + 3u * static_cast<uint32_t>(cell.y * (1 << level) + cell.x);
+}
+
+// calls visit(row, a, b, col_beg, col_end) for the part of the edge in
+// every tile row it spans, a and b are the end points of the part in tile units
+template <typename F>
+void for_each_tile_row(Edge const& edge, glm::ivec2 tile_count, F const& visit)
+{
+  auto p     = to_local(to_poly(edge), glm::vec2(0.f), static_cast<float>(tile_size));
+  auto beg   = evaluate(p, 0.f);
+  auto end   = evaluate(p, 1.f);
+  auto down  = end.y >= beg.y;
+  auto y_min = std::min(beg.y, end.y);
+  auto y_max = std::max(beg.y, end.y);
+
+  auto row_beg = std::max(static_cast<int>(std::floor(y_min)), 0);
+  auto row_end = std::min(static_cast<int>(std::ceil(y_max)) - 1, tile_count.y - 1);
+  for (auto row = row_beg; row <= row_end; ++row)
+  {
+    auto top    = static_cast<float>(row);
+    auto bottom = static_cast<float>(row + 1);
+    float ta, tb;
+    if (down)
+    {
+      ta = beg.y >= top    ? 0.f : solve(p, 1, top);
+      tb = end.y <= bottom ? 1.f : solve(p, 1, bottom);
+    }
+    else
+    {
+      ta = beg.y <= bottom ? 0.f : solve(p, 1, bottom);
+      tb = end.y >= top    ? 1.f : solve(p, 1, top);
+    }
+    auto a = evaluate(p, ta);
+    auto b = evaluate(p, tb);
+
+    auto col_beg = static_cast<int>(std::floor(std::min(a.x, b.x)));
+    auto col_end = std::min(static_cast<int>(std::floor(std::max(a.x, b.x))), tile_count.x - 1);
+    visit(row, a, b, col_beg, col_end);
+  }
+}
+
+// bin.glsl and scan.glsl in one thread
+void bin_edges(std::vector<Edge> const& edges, glm::ivec2 tile_count)
+{
+  g_cpu_tile_offsets.assign(tile_count.x * tile_count.y + 1, 0);
+  g_cpu_backdrops.assign((tile_count.x + 1) * tile_count.y, 0.f);
+  for (auto const& edge : edges)
+    for_each_tile_row(edge, tile_count, [&](int row, glm::vec2 a, glm::vec2 b, int col_beg, int col_end)
+    {
+      g_cpu_backdrops[row * (tile_count.x + 1) + std::clamp(col_beg, 0, tile_count.x)] += b.y - a.y;
+      for (auto col = std::max(col_beg, 0); col <= col_end; ++col)
+        ++g_cpu_tile_offsets[row * tile_count.x + col + 1];
+    });
+
+  // counts to offsets
+  for (size_t i = 1; i < g_cpu_tile_offsets.size(); ++i)
+    g_cpu_tile_offsets[i] += g_cpu_tile_offsets[i - 1];
+
+  g_cpu_tile_cursors.assign(g_cpu_tile_offsets.begin(), g_cpu_tile_offsets.end() - 1);
+  g_cpu_tile_edges.resize(g_cpu_tile_offsets.back());
+  for (uint32_t i = 0; i < edges.size(); ++i)
+    for_each_tile_row(edges[i], tile_count, [&](int row, glm::vec2, glm::vec2, int col_beg, int col_end)
+    {
+      for (auto col = std::max(col_beg, 0); col <= col_end; ++col)
+        g_cpu_tile_edges[g_cpu_tile_cursors[row * tile_count.x + col]++] = i;
+    });
+
+  // backdrop deltas to suffix sums along every row
+  for (int row = 0; row < tile_count.y; ++row)
+  {
+    auto backdrop = 0.f;
+    for (auto col = tile_count.x; col >= 0; --col)
+    {
+      auto& value = g_cpu_backdrops[row * (tile_count.x + 1) + col];
+      auto delta  = value;
+      value       = backdrop;
+      backdrop   += delta;
+    }
+  }
+}
+
+// coefficients.glsl for one edge of a tile
+void add_edge(Edge const& edge, glm::vec2 tile_pos, float* block)
+{
+  auto is_line = edge.type == EdgeType::line;
+  auto curve   = to_local(to_poly(edge), tile_pos, static_cast<float>(tile_size));
+  auto beg     = evaluate(curve, 0.f);
+  auto end     = evaluate(curve, 1.f);
+  block[0]    += is_line ? scaling_coefficient(beg, end) : curve_scaling_coefficient(curve);
+
+  auto lo = glm::clamp(glm::min(beg, end), 0.f, 1.f);
+  auto hi = glm::clamp(glm::max(beg, end), 0.f, 1.f);
+  for (int level = 0; level < tile_levels; ++level)
+  {
+    auto cells    = 1 << level;
+    auto cell_beg = glm::min(glm::ivec2(lo * static_cast<float>(cells)), cells - 1);
+    auto cell_end = glm::min(glm::ivec2(hi * static_cast<float>(cells)), cells - 1);
+    for (auto y = cell_beg.y; y <= cell_end.y; ++y)
+    {
+      if (!is_line)
+      {
+        for (auto x = cell_beg.x; x <= cell_end.x; ++x)
+        {
+          glm::vec3 c;
+          if (!curve_wavelet_coefficients(to_local(curve, glm::vec2(x, y) / static_cast<float>(cells), 1.f / cells), c))
+            continue;
+          auto i = coefficient_index(level, { x, y });
+          block[i + 0] += c.x;
+          block[i + 1] += c.y;
+          block[i + 2] += c.z;
+        }
+        continue;
+      }
+
+      // lines evaluate lane_count cells of the row at once
+      for (auto x0 = cell_beg.x; x0 <= cell_end.x; x0 += lane_count)
+      {
+        auto xs    = splat(static_cast<float>(x0)) + lane_index();
+        auto p0x   = splat(beg.x * cells) - xs;
+        auto p0y   = splat(beg.y * cells - y);
+        auto p1x   = splat(end.x * cells) - xs;
+        auto p1y   = splat(end.y * cells - y);
+        auto valid = splat(0.f) == splat(0.f);
+        clip(p0x, p0y, p1x, p1y, valid);
+        Lanes c[3];
+        wavelet_coefficients(p0x, p0y, p1x, p1y, c);
+
+        float dx[lane_count], dy[lane_count], dxy[lane_count];
+        store(dx,  select(valid, c[0], splat(0.f)));
+        store(dy,  select(valid, c[1], splat(0.f)));
+        store(dxy, select(valid, c[2], splat(0.f)));
+        for (int lane = 0; lane < std::min(lane_count, cell_end.x - x0 + 1); ++lane)
+        {
+          auto i = coefficient_index(level, { x0 + lane, y });
+          block[i + 0] += dx[lane];
+          block[i + 1] += dy[lane];
+          block[i + 2] += dxy[lane];
+        }
+      }
+    }
+  }
+}
+
+// shader.glsl for one tile, values receives the tile_size x tile_size coverage
+void reconstruct(float const* block, float backdrop, float* values)
+{
+  float levels[2][tile_size * tile_size];
+  levels[0][0] = backdrop + block[0];
+  for (int level = 0; level < tile_levels; ++level)
+  {
+    auto cells = 1 << level;
+    auto src   = levels[level % 2];
+    auto dst   = level + 1 == tile_levels ? values : levels[(level + 1) % 2];
+    for (int y = 0; y < 2 * cells; ++y)
+      for (int x = 0; x < 2 * cells; ++x)
+      {
+        auto i  = coefficient_index(level, { x / 2, y / 2 });
+        auto sx = x % 2 == 0 ? 1.f : -1.f;
+        auto sy = y % 2 == 0 ? 1.f : -1.f;
+        dst[y * 2 * cells + x] = src[(y / 2) * cells + x / 2] + sx * block[i] + sy * block[i + 1] + sx * sy * block[i + 2];
+      }
+  }
+}
+
+void rasterize_cpu(std::vector<Edge> const& edges, VkExtent2D extent, float* pixels)
+{
+  auto tile_count = glm::ivec2((extent.width + tile_size - 1) / tile_size, (extent.height + tile_size - 1) / tile_size);
+  bin_edges(edges, tile_count);
+
+  get_scheduler().parallel_for(tile_count.x * tile_count.y, [&](uint32_t tile)
+  {
+    auto tile_id  = glm::ivec2(tile % tile_count.x, tile / tile_count.x);
+    auto backdrop = g_cpu_backdrops[tile_id.y * (tile_count.x + 1) + tile_id.x];
+
+    float values[tile_size * tile_size];
+    auto beg = g_cpu_tile_offsets[tile];
+    auto end = g_cpu_tile_offsets[tile + 1];
+    if (beg == end)
+      std::fill(std::begin(values), std::end(values), backdrop);
+    else
+    {
+      float block[block_size] = {};
+      auto tile_pos = glm::vec2(tile_id * static_cast<int>(tile_size));
+      for (auto i = beg; i < end; ++i)
+        add_edge(edges[g_cpu_tile_edges[i]], tile_pos, block);
+      reconstruct(block, backdrop, values);
+    }
+
+    // same clamp as shader.glsl, pixels outside the image are dropped
+    for (uint32_t y = 0; y < tile_size; ++y)
+      for (uint32_t x = 0; x < tile_size; ++x)
+      {
+        auto px = tile_id.x * tile_size + x;
+        auto py = tile_id.y * tile_size + y;
+        if (px >= extent.width || py >= extent.height)
+          continue;
+        auto coverage = std::clamp(std::abs(values[y * tile_size + x]), 0.f, 1.f);
+        auto pixel    = pixels + (static_cast<size_t>(py) * extent.width + px) * 4;
+        pixel[0] = pixel[1] = pixel[2] = coverage;
+        pixel[3] = 1.f;
+      }
+  });
+}
+
+float max_difference(float const* a, float const* b, VkExtent2D extent)
+{
+  auto difference = 0.f;
+  for (size_t i = 0; i < static_cast<size_t>(extent.width) * extent.height * 4; ++i)
+    difference = std::max(difference, std::abs(a[i] - b[i]));
+  return difference;
+}
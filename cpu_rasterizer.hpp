@@ -0,0 +1,19 @@
+#pragma once
+
+#include "renderer.hpp"
+
+//
+// cpu implementation of the wavelet rasterization in bin.glsl, scan.glsl,
+// coefficients.glsl and shader.glsl, used where no vulkan device exists
+// and as reference for the gpu output
+//
+
+// rasterize edges into width * height RGBA32F pixels laid out like g_wr_image,
+// tiles are spread over all cores
+void rasterize_cpu(std::vector<Edge> const& edges, VkExtent2D extent, float* pixels);
+
+// threads rasterize_cpu runs on
+uint32_t get_cpu_thread_count();
+
+// largest absolute difference of two RGBA32F images
+float max_difference(float const* a, float const* b, VkExtent2D extent);
@@ -0,0 +1,401 @@
+#include "path_loader.hpp"
+
+#include <glm/gtc/constants.hpp>
+
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+//                              mapped file
+////////////////////////////////////////////////////////////////////////////////
+
+// read only mapping of a whole file, the os pages it in while it is parsed
+// and may drop the pages behind the parser again
+class MappedFile
+{
+public:
+  explicit MappedFile(std::filesystem::path const& path);
+  ~MappedFile();
+
+  MappedFile(MappedFile const&)            = delete;
+  MappedFile& operator=(MappedFile const&) = delete;
+
+  auto data() const { return m_data; }
+
+private:
+  std::string_view m_data;
+#ifdef _WIN32
+  HANDLE           m_file    = INVALID_HANDLE_VALUE;
+  HANDLE           m_mapping = nullptr;
+#endif
+};
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(std::filesystem::path const& path)
+{
+  m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  exit_if(m_file == INVALID_HANDLE_VALUE);
+  LARGE_INTEGER size;
+  exit_if(!GetFileSizeEx(m_file, &size));
+  if (!size.QuadPart)
+    return;
+  m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  exit_if(!m_mapping);
+  auto data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+  exit_if(!data);
+  m_data = { static_cast<char const*>(data), static_cast<size_t>(size.QuadPart) };
+}
+
+MappedFile::~MappedFile()
+{
+  if (!m_data.empty())
+    UnmapViewOfFile(m_data.data());
+  if (m_mapping)
+    CloseHandle(m_mapping);
+  CloseHandle(m_file);
+}
+
+#else
+
+MappedFile::MappedFile(std::filesystem::path const& path)
+{
+  auto fd = open(path.c_str(), O_RDONLY);
+  exit_if(fd < 0);
+  struct stat info;
+  exit_if(fstat(fd, &info) != 0);
+  if (info.st_size)
+  {
+    auto data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    exit_if(data == MAP_FAILED);
+    madvise(data, info.st_size, MADV_SEQUENTIAL);
+    m_data = { static_cast<char const*>(data), static_cast<size_t>(info.st_size) };
+  }
+  close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+  if (!m_data.empty())
+    munmap(const_cast<char*>(m_data.data()), m_data.size());
+}
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+//                              parse funcs
+////////////////////////////////////////////////////////////////////////////////
+
+// the add_ funcs append to g_edges, which holds the current chunk while loading,
+// flush hands it over once it is full
+
+constexpr std::string_view binary_magic = "WRP1";
+
+// svg path data, parsing stops at the first error as svg renderers do
+void parse_path_data(std::string_view d, std::function<void()> const& flush)
+{
+  size_t pos = 0;
+  auto skip = [&]
+  {
+    while (pos < d.size() && (std::isspace(static_cast<unsigned char>(d[pos])) || d[pos] == ','))
+      ++pos;
+  };
+  auto number = [&](float& value)
+  {
+    skip();
+    if (pos < d.size() && d[pos] == '+')
+      ++pos;
+    auto [ptr, ec] = std::from_chars(d.data() + pos, d.data() + d.size(), value);
+    pos = ptr - d.data();
+    return ec == std::errc();
+  };
+  // arc flags may be written without separator, e.g. "a1 1 0 01 5 5"
+  auto flag = [&](bool& value)
+  {
+    skip();
+    if (pos >= d.size() || (d[pos] != '0' && d[pos] != '1'))
+      return false;
+    value = d[pos++] == '1';
+    return true;
+  };
+
+  glm::vec2 start   = {};
+  glm::vec2 current = {};
+  glm::vec2 control = {};
+  char      command = 0;
+  char      last    = 0;
+  auto point = [&](glm::vec2& p, bool relative)
+  {
+    if (!number(p.x) || !number(p.y))
+      return false;
+    if (relative)
+      p += current;
+    return true;
+  };
+  auto line_to = [&](glm::vec2 p)
+  {
+    if (p != current)
+      add_line(current, p);
+    current = p;
+  };
+
+  // a command letter may be followed by several argument sets
+  auto parse = [&]
+  {
+    while (true)
+    {
+      skip();
+      if (pos >= d.size())
+        return;
+      if (std::isalpha(static_cast<unsigned char>(d[pos])))
+        command = d[pos++];
+      else if (!command)
+        return;
+
+      auto relative = std::islower(static_cast<unsigned char>(command)) != 0;
+      auto type     = static_cast<char>(std::toupper(static_cast<unsigned char>(command)));
+      glm::vec2 p1, p2, p;
+      switch (type)
+      {
+      case 'M':
+        if (!point(p, relative))
+          return;
+        line_to(start);
+        start   = p;
+        current = p;
+        // further pairs are lines
+        command = relative ? 'l' : 'L';
+        break;
+      case 'L':
+        if (!point(p, relative))
+          return;
+        line_to(p);
+        break;
+      case 'H':
+        p = current;
+        if (!number(p.x))
+          return;
+        if (relative)
+          p.x += current.x;
+        line_to(p);
+        break;
+      case 'V':
+        p = current;
+        if (!number(p.y))
+          return;
+        if (relative)
+          p.y += current.y;
+        line_to(p);
+        break;
+      case 'C':
+      case 'S':
+        // s reflects the second control point of a preceding cubic
+        p1 = last == 'C' || last == 'S' ? 2.f * current - control : current;
+        if ((type == 'C' && !point(p1, relative)) || !point(p2, relative) || !point(p, relative))
+          return;
+        add_bezier<4>({ current, p1, p2, p });
+        control = p2;
+        current = p;
+        break;
+      case 'Q':
+      case 'T':
+        p1 = last == 'Q' || last == 'T' ? 2.f * current - control : current;
+        if ((type == 'Q' && !point(p1, relative)) || !point(p, relative))
+          return;
+        add_bezier<3>({ current, p1, p });
+        control = p1;
+        current = p;
+        break;
+      case 'A':
+      {
+        glm::vec2 radius;
+        float     rotation;
+        bool      large_arc, sweep;
+        if (!number(radius.x) || !number(radius.y) || !number(rotation) || !flag(large_arc) || !flag(sweep) || !point(p, relative))
+          return;
+        add_arc(current, radius, glm::radians(rotation), large_arc, sweep, p);
+        current = p;
+        break;
+      }
+      case 'Z':
+        line_to(start);
+        // z takes no arguments
+        command = 0;
+        break;
+      default:
+        return;
+      }
+      last = type;
+      flush();
+    }
+  };
+  parse();
+
+  // fills close open subpaths
+  line_to(start);
+  flush();
+}
+
+// the d attribute of every path element
+void parse_svg(std::string_view svg, std::function<void()> const& flush)
+{
+  for (auto pos = svg.find("<path"); pos != std::string_view::npos; pos = svg.find("<path", pos + 1))
+  {
+    auto end = svg.find('>', pos);
+    if (end == std::string_view::npos)
+      return;
+    auto tag = svg.substr(pos, end - pos);
+    if (tag.size() < 6 || !std::isspace(static_cast<unsigned char>(tag[5])))
+      continue;
+
+    // preceded by whitespace, so attributes like id= do not match
+    for (auto d = tag.find("d="); d != std::string_view::npos; d = tag.find("d=", d + 1))
+    {
+      auto quote = d + 2 < tag.size() ? tag[d + 2] : '\0';
+      if (!std::isspace(static_cast<unsigned char>(tag[d - 1])) || (quote != '"' && quote != '\''))
+        continue;
+      auto close = tag.find(quote, d + 3);
+      if (close != std::string_view::npos)
+        parse_path_data(tag.substr(d + 3, close - d - 3), flush);
+      break;
+    }
+  }
+}
+
+// segments as written by write_paths, exits on truncated or unknown records
+void parse_binary(std::string_view data, std::function<void()> const& flush)
+{
+  size_t pos = binary_magic.size();
+  auto read = [&](glm::vec2& p)
+  {
+    exit_if(pos + sizeof(p) > data.size());
+    std::memcpy(&p, data.data() + pos, sizeof(p));
+    pos += sizeof(p);
+  };
+
+  glm::vec2 start   = {};
+  glm::vec2 current = {};
+  glm::vec2 p1, p2, p;
+  // open subpaths are closed as in parse_path_data
+  auto close = [&]
+  {
+    if (current != start)
+      add_line(current, start);
+  };
+  while (pos < data.size())
+  {
+    switch (data[pos++])
+    {
+    case 'M':
+      read(p);
+      close();
+      start = p;
+      break;
+    case 'L':
+      read(p);
+      add_line(current, p);
+      break;
+    case 'Q':
+      read(p1);
+      read(p);
+      add_bezier<3>({ current, p1, p });
+      break;
+    case 'C':
+      read(p1);
+      read(p2);
+      read(p);
+      add_bezier<4>({ current, p1, p2, p });
+      break;
+    case 'Z':
+      close();
+      p = start;
+      break;
+    default:
+      exit(1);
+    }
+    current = p;
+    flush();
+  }
+  close();
+  flush();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                              funcs
+////////////////////////////////////////////////////////////////////////////////
+
+void load_paths(std::filesystem::path const& path, size_t chunk_size, std::function<void(std::span<Edge const>)> const& consume)
+{
+  MappedFile file(path);
+  auto data = file.data();
+
+  // g_edges is the chunk, the scene in it is put back afterwards
+  auto edges = std::exchange(g_edges, {});
+  auto flush = [&]
+  {
+    if (g_edges.size() < chunk_size)
+      return;
+    consume(g_edges);
+    g_edges.clear();
+  };
+  if (data.starts_with(binary_magic))
+    parse_binary(data, flush);
+  else
+    parse_svg(data, flush);
+  if (!g_edges.empty())
+    consume(g_edges);
+  g_edges = std::move(edges);
+}
+
+void write_paths(std::filesystem::path const& path, std::span<Edge const> edges)
+{
+  std::ofstream file(path, std::ios::binary);
+  exit_if(!file.is_open());
+  file.write(binary_magic.data(), binary_magic.size());
+  auto write = [&](char command, std::initializer_list<glm::vec2> points)
+  {
+    file.put(command);
+    for (auto p : points)
+      file.write(reinterpret_cast<char const*>(&p), sizeof(p));
+  };
+
+  // a move only where an edge does not continue the previous one
+  glm::vec2 current = {};
+  for (size_t i = 0; i < edges.size(); ++i)
+  {
+    auto const& edge = edges[i];
+    if (!i || edge.p0 != current)
+      write('M', { edge.p0 });
+    switch (edge.type)
+    {
+    case EdgeType::line:
+      write('L', { edge.p1 });
+      current = edge.p1;
+      break;
+    case EdgeType::quadratic:
+      write('Q', { edge.p1, edge.p2 });
+      current = edge.p2;
+      break;
+    case EdgeType::cubic:
+      write('C', { edge.p1, edge.p2, edge.p3 });
+      current = edge.p3;
+      break;
+    }
+  }
+  exit_if(!file);
+}
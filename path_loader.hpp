@@ -0,0 +1,23 @@
+#pragma once
+
+#include "renderer.hpp"
+
+#include <span>
+#include <functional>
+#include <filesystem>
+
+//
+// path files, either svg (the d attribute of every path element, in pixel
+// coordinates) or the binary format of write_paths, which starts with "WRP1"
+// and stores per segment a command byte M, L, Q, C or Z followed by its
+// little endian float32 points
+//
+// files are memory mapped and parsed in place, so only the pages being parsed
+// and the current chunk of edges are resident, open subpaths are closed
+//
+
+// calls consume with chunks of at least chunk_size edges, the last one may be smaller,
+// exits if the file cannot be opened
+void load_paths(std::filesystem::path const& path, size_t chunk_size, std::function<void(std::span<Edge const>)> const& consume);
+
+void write_paths(std::filesystem::path const& path, std::span<Edge const> edges);
@@ -0,0 +1,170 @@
+#include "preprocess.hpp"
+#include "scheduler.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+////////////////////////////////////////////////////////////////////////////////
+//                              funcs
+////////////////////////////////////////////////////////////////////////////////
+
+// edges per task, small enough for the scheduler to balance 1M edge scenes over many cores
+constexpr size_t chunk_size = 1 << 14;
+
+auto get_chunk_count(size_t edge_count)
+{
+  return static_cast<uint32_t>((edge_count + chunk_size - 1) / chunk_size);
+}
+
+auto get_chunk(std::span<Edge const> edges, uint32_t chunk)
+{
+  auto first = chunk * chunk_size;
+  return edges.subspan(first, std::min(chunk_size, edges.size() - first));
+}
+
+// calls emit with the edges the chunk keeps, in order, both passes run it, so they agree on the count
+template <typename F>
+void preprocess_chunk(std::span<Edge const> chunk, Transform const& transform, glm::vec2 viewport, F const& emit)
+{
+  // an output axis depending on both input axes breaks monotone curves
+  auto const& m     = transform.linear;
+  auto        split = (m[0].x != 0.f && m[1].x != 0.f) || (m[0].y != 0.f && m[1].y != 0.f);
+  auto m00 = splat(m[0].x), m01 = splat(m[0].y), m10 = splat(m[1].x), m11 = splat(m[1].y);
+  auto ox  = splat(transform.offset.x), oy = splat(transform.offset.y);
+  auto zero = splat(0.f), width = splat(viewport.x), height = splat(viewport.y);
+
+  for (size_t first = 0; first < chunk.size(); first += lane_count)
+  {
+    // the points of an edge go to a lane, lanes past the chunk repeat its last edge,
+    // points past the degree of an edge repeat p0, so they leave its bounds alone
+    auto  lanes = static_cast<int>(std::min<size_t>(lane_count, chunk.size() - first));
+    float x[4][lane_count];
+    float y[4][lane_count];
+    for (int lane = 0; lane < lane_count; ++lane)
+    {
+      auto const& edge   = chunk[first + std::min(lane, lanes - 1)];
+      glm::vec2 points[] = { edge.p0, edge.p1, edge.p2, edge.p3 };
+      auto point_count   = edge.type == EdgeType::line ? 2 : edge.type == EdgeType::quadratic ? 3 : 4;
+      for (int i = 0; i < 4; ++i)
+      {
+        x[i][lane] = points[i < point_count ? i : 0].x;
+        y[i][lane] = points[i < point_count ? i : 0].y;
+      }
+    }
+
+    // transform the control points and take their bounds, curves stay inside them
+    auto min_x = splat(0.f), min_y = splat(0.f), max_x = splat(0.f), max_y = splat(0.f);
+    for (int i = 0; i < 4; ++i)
+    {
+      auto px = load(x[i]);
+      auto py = load(y[i]);
+      auto tx = m00 * px + m10 * py + ox;
+      auto ty = m01 * px + m11 * py + oy;
+      store(x[i], tx);
+      store(y[i], ty);
+      min_x = i ? min(min_x, tx) : tx;
+      min_y = i ? min(min_y, ty) : ty;
+      max_x = i ? max(max_x, tx) : tx;
+      max_y = i ? max(max_y, ty) : ty;
+    }
+
+    // as in cull_edges of tiled_export.cpp, nan bounds are dropped
+    auto drop  = to_bits(!(max_x > zero) | !(max_y > zero) | !(min_y < height));
+    auto right = to_bits(!(min_x < width));
+    for (int lane = 0; lane < lanes; ++lane)
+    {
+      if (drop >> lane & 1)
+        continue;
+      Edge edge
+      {
+        .p0   = { x[0][lane], y[0][lane] },
+        .p1   = { x[1][lane], y[1][lane] },
+        .p2   = { x[2][lane], y[2][lane] },
+        .p3   = { x[3][lane], y[3][lane] },
+        .type = chunk[first + lane].type,
+      };
+      if (right >> lane & 1)
+      {
+        // rows outside the viewport have no pixels
+        auto beg = std::clamp(edge.p0.y, 0.f, viewport.y);
+        auto end = std::clamp(get_end(edge).y, 0.f, viewport.y);
+        if (beg != end)
+          emit(Edge{ .p0 = { viewport.x, beg }, .p1 = { viewport.x, end }, .type = EdgeType::line });
+        continue;
+      }
+      if (!split || edge.type == EdgeType::line)
+      {
+        emit(edge);
+        continue;
+      }
+      std::array<Edge, max_monotone_pieces> pieces;
+      auto count = get_monotone_pieces(edge, pieces);
+      for (size_t i = 0; i < count; ++i)
+        emit(pieces[i]);
+    }
+  }
+}
+
+// tiles of the viewport grid inside the control point bounds of the edge
+auto get_tile_edge_count(Edge const& edge, glm::vec2 grid)
+{
+  glm::vec2 points[] = { edge.p0, edge.p1, edge.p2, edge.p3 };
+  auto point_count   = edge.type == EdgeType::line ? 2 : edge.type == EdgeType::quadratic ? 3 : 4;
+  auto min           = points[0];
+  auto max           = points[0];
+  for (int i = 1; i < point_count; ++i)
+  {
+    min = glm::min(min, points[i]);
+    max = glm::max(max, points[i]);
+  }
+  auto beg = glm::max(glm::floor(min / static_cast<float>(tile_size)), glm::vec2(0.f));
+  auto end = glm::min(glm::floor(max / static_cast<float>(tile_size)), grid - 1.f);
+  if (beg.x > end.x || beg.y > end.y)
+    return size_t(0);
+  return static_cast<size_t>(end.x - beg.x + 1) * static_cast<size_t>(end.y - beg.y + 1);
+}
+
+PreprocessPlan plan_preprocess(std::span<Edge const> edges, Transform const& transform, VkExtent2D viewport)
+{
+  PreprocessPlan plan =
+  {
+    .edges     = edges,
+    .transform = transform,
+    .viewport  = glm::vec2(viewport.width, viewport.height),
+  };
+  auto grid        = glm::ceil(plan.viewport / static_cast<float>(tile_size));
+  auto chunk_count = get_chunk_count(edges.size());
+
+  // every chunk counts into its own entries
+  std::vector<size_t> counts(chunk_count);
+  std::vector<size_t> tile_edge_counts(chunk_count);
+  get_scheduler().parallel_for(chunk_count, [&](uint32_t chunk)
+  {
+    size_t count           = 0;
+    size_t tile_edge_count = 0;
+    preprocess_chunk(get_chunk(edges, chunk), transform, plan.viewport, [&](Edge const& edge)
+    {
+      ++count;
+      tile_edge_count += get_tile_edge_count(edge, grid);
+    });
+    counts[chunk]           = count;
+    tile_edge_counts[chunk] = tile_edge_count;
+  });
+
+  plan.offsets.resize(chunk_count + 1);
+  std::exclusive_scan(counts.begin(), counts.end(), plan.offsets.begin(), size_t(0));
+  plan.offsets.back()  = chunk_count ? plan.offsets[chunk_count - 1] + counts.back() : 0;
+  plan.tile_edge_count = std::reduce(tile_edge_counts.begin(), tile_edge_counts.end(), size_t(0));
+  return plan;
+}
+
+void write_preprocessed(PreprocessPlan const& plan, Edge* dst)
+{
+  get_scheduler().parallel_for(get_chunk_count(plan.edges.size()), [&](uint32_t chunk)
+  {
+    auto out = dst + plan.offsets[chunk];
+    preprocess_chunk(get_chunk(plan.edges, chunk), plan.transform, plan.viewport, [&](Edge const& edge) { *out++ = edge; });
+  });
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "renderer.hpp"
+
+#include <span>
+#include <vector>
+
+//
+// host side preprocessing of paths before they reach the gpu, edges are
+// mapped into pixel coordinates by a Transform and culled against the
+// viewport: edges left of it, above or below it change no pixel and are
+// dropped, edges right of it only add their height to the backdrops and
+// become lines on its right border, clipped to its rows
+//
+// the edges are cut into chunks which the scheduler of scheduler.hpp spreads
+// over all cores, transform and culling run lane_count edges at a time with
+// simd.hpp, transforms which mix the axes split curves into monotone pieces
+// again afterwards
+//
+// a first pass counts what every chunk keeps, so the second one writes every
+// chunk straight into its slice of the destination, usually an upload slot,
+// and no chunk is gathered or copied afterwards
+//
+
+// the counts of the first pass, edges has to outlive the plan
+struct PreprocessPlan
+{
+  std::span<Edge const> edges;
+  Transform             transform;
+  glm::vec2             viewport;
+  // the edges of chunk i start at offsets[i], the last entry is the total
+  std::vector<size_t>   offsets;
+  // tile list entries of the kept edges, as compute_bin_capacities counts them
+  size_t                tile_edge_count;
+};
+
+PreprocessPlan plan_preprocess(std::span<Edge const> edges, Transform const& transform, VkExtent2D viewport);
+
+// dst has room for plan.offsets.back() edges, they keep all levels
+void write_preprocessed(PreprocessPlan const& plan, Edge* dst);
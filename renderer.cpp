@@ -0,0 +1,3285 @@
+#define VMA_IMPLEMENTATION
+#include "renderer.hpp"
+#include "retained_scene.hpp"
+#include "preprocess.hpp"
+
+#include <SDL3/SDL_vulkan.h>
+#include <SDL3/SDL_init.h>
+#include <SDL3/SDL_filesystem.h>
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <print>
+#include <format>
+#include <random>
+#include <cassert>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <numeric>
+#include <span>
+#include <string>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+////////////////////////////////////////////////////////////////////////////////
+//                              global vars
+////////////////////////////////////////////////////////////////////////////////
+
+SDL_Window*              g_window;
+VkInstance               g_instance;
+VkDebugUtilsMessengerEXT g_debug_messenger;
+VkSurfaceKHR             g_surface;
+VkPhysicalDevice         g_physical_device;
+VkQueue                  g_queue;
+uint32_t                 g_queue_family_index;
+// submissions to g_queue lock it, render contexts may share the queue
+std::mutex               g_queue_mutex;
+VkDevice                 g_device;
+VkSwapchainKHR           g_swapchain;
+VkFormat                 g_swapchain_image_format;
+uint32_t                 g_swapchain_image_count;
+VkExtent2D               g_swapchain_extent;
+std::vector<VkImage>     g_swapchain_images;
+std::vector<VkImageView> g_swapchain_image_views;
+VkCommandPool            g_command_pool;
+VmaAllocator             g_allocator;
+VkDescriptorPool         g_descriptor_pool;
+VkDescriptorSetLayout    g_descriptor_set_layout;
+std::vector<VkDescriptorSet> g_descriptor_sets;
+bool                     g_validation;
+// the reconstruct pass writes into the swapchain images instead of g_wr_image,
+// with the srgb encoding done in the shader when the surface asked for it
+bool                     g_direct_output;
+bool                     g_encode_srgb;
+// coefficients.glsl sums in subgroups and shared memory before its global atomics
+bool                     g_subgroup_reduce;
+
+std::vector<Frame>     g_frames;
+uint32_t               g_frame_index = 0;
+uint32_t               g_frames_in_flight = 2;
+std::vector<Recording> g_recordings;
+// submissions signal increasing values, value n means n submissions are done
+VkSemaphore            g_timeline;
+uint64_t               g_timeline_value;
+
+// matches Tile, TileEdge, Layer, TileLayers and Counters in common.glsl
+struct Tile
+{
+  uint32_t offset;
+  uint32_t count;
+  uint32_t cursor;
+  uint32_t block;
+};
+
+struct TileEdge
+{
+  uint32_t edge;
+  uint32_t tile;
+};
+
+// a layer of the batch and its tiles, see common.glsl
+struct LayerInfo
+{
+  glm::vec4  color0;
+  glm::vec4  color1;
+  glm::vec2  p0;
+  glm::vec2  p1;
+  PaintType  paint_type;
+  uint32_t   first_edge;
+  uint32_t   first_tile;
+  uint32_t   first_row;
+  glm::ivec2 tile_min;
+  glm::ivec2 tile_extent;
+};
+static_assert(sizeof(LayerInfo) == 80, "std430 layout of Layer");
+
+// an instance of the batch, see common.glsl, the table starts with their count
+struct InstanceInfo
+{
+  glm::vec2 origin;
+  uint32_t  first_edge;
+  uint32_t  first_index;
+};
+static_assert(sizeof(InstanceInfo) == 16, "std430 layout of Instance");
+
+// the count is padded to the alignment of the instances
+constexpr VkDeviceSize instance_header_size = 8;
+
+struct TileLayers
+{
+  uint32_t offset;
+  uint32_t count;
+  uint32_t cursor;
+};
+
+struct Counters
+{
+  uint32_t                  tile_edge_count;
+  uint32_t                  block_count;
+  VkDispatchIndirectCommand coefficient_groups;
+  VkDispatchIndirectCommand reconstruct_groups;
+  glm::ivec2                reconstruct_origin;
+};
+
+// matches PushConstants in common.glsl, every kernel reads its buffers through these addresses
+struct PushConstants
+{
+  VkDeviceAddress edges;
+  VkDeviceAddress tiles;
+  VkDeviceAddress tile_edges;
+  VkDeviceAddress backdrops;
+  VkDeviceAddress counters;
+  VkDeviceAddress blocks;
+  VkDeviceAddress tile_backdrops;
+  VkDeviceAddress dirty_tiles;
+  VkDeviceAddress layers;
+  VkDeviceAddress tile_layers;
+  VkDeviceAddress layer_list;
+  VkDeviceAddress instances;
+  VkExtent2D      tile_count;
+  uint32_t        edge_count;
+  uint32_t        tile_edge_capacity;
+  uint32_t        block_capacity;
+  uint32_t        dirty_tile_count;
+  uint32_t        flags;
+  uint32_t        layer_count;
+};
+// vulkan guarantees no more
+static_assert(sizeof(PushConstants) <= 128, "push constant size");
+
+// matches FLAG_RETAINED, FLAG_ACCUMULATE, FLAG_COMPOSITE and FLAG_INSTANCED in common.glsl
+constexpr uint32_t retained_flag   = 1;
+constexpr uint32_t accumulate_flag = 2;
+constexpr uint32_t composite_flag  = 4;
+constexpr uint32_t instanced_flag  = 8;
+
+// tiles a batch reconstructs, the swapchain images always need all of them
+enum class Reconstruct
+{
+  all,
+  dirty,
+  none,
+};
+
+// what a recording rasterizes, accumulating batches add their edges to the
+// coefficients of the previous one, the edges of a layer follow each other
+struct Batch
+{
+  std::span<Edge const>         edges;
+  std::span<LayerInfo const>    layers;
+  std::span<uint32_t const>     dirty_tiles;
+  bool                          accumulate;
+  Reconstruct                   reconstruct;
+  // instead of edges, the instances place ranges of the edges at instance_edges,
+  // instance_edge_count edges in all
+  std::span<InstanceInfo const> instances;
+  VkDeviceAddress               instance_edges;
+  uint32_t                      instance_edge_count;
+};
+
+// upper bounds of tile_edges entries, coefficient blocks and the tiles and
+// backdrop rows of the layers, see compute_bin_capacities
+struct BinCapacities
+{
+  uint32_t tile_edges;
+  uint32_t blocks;
+  uint32_t layer_tiles;
+  uint32_t layer_rows;
+};
+
+// the buffers a batch is binned and rasterized with, the frames use g_bin,
+// every render context has its own
+struct BinResources
+{
+  VkExtent2D    tile_count;
+  BinCapacities capacities;
+  Buffer        tiles;
+  Buffer        tile_edges;
+  Buffer        backdrops;
+  Buffer        counters;
+  Buffer        blocks;
+  Buffer        tile_layers;
+  Buffer        layer_list;
+};
+
+// persistently mapped ring of slot_count slots, every recording writes its batch
+// into its slot right before its submission, discrete gpus without rebar copy the
+// slot into edge_buffer at the start of the submission instead of reading host memory
+struct UploadResources
+{
+  Buffer       ring;
+  std::byte*   data;
+  VkDeviceSize slot_size;
+  size_t       slot_count;
+  bool         staging;
+  Buffer       edge_buffer;
+};
+
+//
+// Wavelet Rasterization Resources
+//
+VkPipeline        g_wr_pipeline;
+VkPipelineLayout  g_wr_pipeline_layout;
+Image             g_wr_image;
+VkFormat          g_output_format = VK_FORMAT_R32G32B32A32_SFLOAT;
+std::vector<Edge> g_edges;
+
+//
+// Upload Resources
+//
+// every recording owns a slot of the ring
+UploadResources   g_upload;
+// recordings upload and record again once their version is behind
+uint64_t          g_scene_version;
+
+//
+// Tile Binning Resources
+//
+VkPipeline        g_bin_count_pipeline;
+VkPipeline        g_bin_scatter_pipeline;
+VkPipeline        g_scan_pipeline;
+BinResources      g_bin;
+
+//
+// Layer Resources
+//
+// the tiles of every layer of a batch have their own edge lists, blocks and
+// backdrops, without g_layers the batch is one layer over the grid, compose.glsl
+// lists the layers of every tile of the image when compositing
+VkPipeline             g_compose_scan_pipeline;
+VkPipeline             g_compose_scatter_pipeline;
+std::vector<Layer>     g_layers;
+std::vector<LayerInfo> g_layer_infos;
+
+//
+// Instance Resources
+//
+// the edges are uploaded once and every frame places ranges of them, the host
+// keeps a copy for the bin capacities
+Buffer                    g_instance_edge_buffer;
+std::vector<Edge>         g_instance_edges;
+std::vector<Instance>     g_instances;
+std::vector<InstanceInfo> g_instance_infos;
+uint32_t                  g_instance_edge_count;
+
+//
+// Sparse Coefficient Resources
+//
+VkPipeline        g_coefficient_pipeline;
+
+//
+// Retained Resources
+//
+// every tile owns a block, blocks and tile backdrops keep the coefficients of
+// all paths across frames, rebuilds start over from all paths, also after
+// rebuild_interval changed frames so the rounding of added and subtracted
+// paths does not pile up
+constexpr uint32_t    rebuild_interval = 256;
+bool                  g_retained;
+float                 g_lod_threshold;
+Buffer                g_tile_backdrop_buffer;
+bool                  g_rebuild;
+uint32_t              g_frames_since_rebuild;
+std::vector<Edge>     g_delta_edges;
+std::vector<uint32_t> g_dirty_tiles;
+// a streamed chunk waits in its upload slot until the next one shows whether it is the last
+bool                  g_stream_pending;
+uint32_t              g_stream_edge_count;
+uint32_t              g_stream_chunk_index;
+
+//
+// Headless Resources
+//
+bool             g_headless;
+VkExtent2D       g_headless_extent = { 500, 500 };
+// whether init_vk created the surface, swapchain and present semaphores of the
+// window, a Rasterizer never does whatever g_headless is
+bool             g_windowed;
+Buffer           g_readback_buffer;
+
+//
+// Frame Readback Resources
+//
+// a readback per recording, the worker thread takes the submitted frames in
+// order and marks the readback free again after the consumer returned
+struct PendingFrame
+{
+  uint32_t recording_index;
+  uint64_t timeline_value;
+  uint64_t frame;
+};
+FrameConsumer            g_frame_consumer;
+std::vector<Readback>    g_frame_readbacks;
+std::vector<bool>        g_frame_readbacks_busy;
+std::deque<PendingFrame> g_pending_frames;
+uint64_t                 g_frames_read_back;
+bool                     g_stop_frame_readback;
+std::mutex               g_frame_readback_mutex;
+std::condition_variable  g_frame_readback_cv;
+std::thread              g_frame_readback_thread;
+
+//
+// Profiling Resources
+//
+
+// compute passes also get a compute invocation statistics query
+constexpr uint32_t compute_pass_count = pass_blit;
+
+// gpu times of the last samples per pass, older ones are overwritten
+struct PassTimes
+{
+  std::vector<double> samples;
+  size_t              next;
+};
+
+constexpr size_t profile_window = 1000;
+
+VkQueryPool                       g_timestamp_pool;
+VkQueryPool                       g_statistics_pool;
+float                             g_timestamp_period;
+uint32_t                          g_query_frame;
+uint64_t                          g_profiled_frame_count;
+std::array<PassTimes, pass_count> g_pass_times;
+std::ofstream                     g_profile_csv;
+
+//
+// Pipeline Cache Resources
+//
+VkPipelineCache       g_pipeline_cache;
+std::filesystem::path g_pipeline_cache_path;
+size_t                g_pipeline_cache_loaded_size;
+
+//
+// Render Context Resources
+//
+// queues of a compute only family when the device has one, otherwise the
+// queues of the graphics family after g_queue, contexts take them in turn
+// and share g_queue when there are none, see Rasterizer
+struct ContextQueue
+{
+  VkQueue    handle;
+  std::mutex mutex;
+};
+uint32_t                 g_context_queue_family_index;
+std::deque<ContextQueue> g_context_queues;
+
+////////////////////////////////////////////////////////////////////////////////
+//                              shaders
+////////////////////////////////////////////////////////////////////////////////
+
+// spir-v words compiled from the .glsl files at build time, see CMakeLists.txt
+
+constexpr uint32_t shader_spv[] =
+{
+#include "shader.spv.inc"
+};
+
+constexpr uint32_t bin_spv[] =
+{
+#include "bin.spv.inc"
+};
+
+constexpr uint32_t scan_spv[] =
+{
+#include "scan.spv.inc"
+};
+
+constexpr uint32_t compose_spv[] =
+{
+#include "compose.spv.inc"
+};
+
+constexpr uint32_t coefficients_spv[] =
+{
+#include "coefficients.spv.inc"
+};
+
+constexpr uint32_t coefficients_subgroup_spv[] =
+{
+#include "coefficients_subgroup.spv.inc"
+};
+
+// shader.glsl per output format of g_wr_image, g_wr_pipeline uses shader_spv
+// for the swapchain images
+constexpr uint32_t shader_r8_spv[] =
+{
+#include "shader_r8.spv.inc"
+};
+
+constexpr uint32_t shader_r16f_spv[] =
+{
+#include "shader_r16f.spv.inc"
+};
+
+constexpr uint32_t shader_rgba8_spv[] =
+{
+#include "shader_rgba8.spv.inc"
+};
+
+constexpr uint32_t shader_rgba32f_spv[] =
+{
+#include "shader_rgba32f.spv.inc"
+};
+
+// pipelines are created when a target first uses the format
+struct OutputVariant
+{
+  VkFormat                  format;
+  uint32_t                  pixel_size;
+  bool                      extended;
+  std::span<uint32_t const> code;
+  VkPipeline                pipeline;
+};
+
+OutputVariant g_output_variants[]
+{
+  { VK_FORMAT_R8_UNORM,            1,  true,  shader_r8_spv      },
+  { VK_FORMAT_R16_SFLOAT,          2,  true,  shader_r16f_spv    },
+  { VK_FORMAT_R8G8B8A8_UNORM,      4,  false, shader_rgba8_spv   },
+  { VK_FORMAT_R32G32B32A32_SFLOAT, 16, false, shader_rgba32f_spv },
+};
+
+auto& get_output_variant(VkFormat format)
+{
+  auto it = std::ranges::find(g_output_variants, format, &OutputVariant::format);
+  exit_if(it == std::end(g_output_variants));
+  return *it;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                              misc funcs
+////////////////////////////////////////////////////////////////////////////////
+
+void destroy(Image& image)
+{
+  assert(image.handle && image.allocation && image.view);
+  vkDestroyImageView(g_device, image.view, nullptr);
+  vmaDestroyImage(g_allocator, image.handle, image.allocation);
+  image = {};
+}
+
+void destroy(Buffer& buffer)
+{
+  assert(buffer.handle && buffer.allocation);
+  vmaDestroyBuffer(g_allocator, buffer.handle, buffer.allocation);
+  buffer = {};
+}
+
+void release_resources()
+{
+  vkDeviceWaitIdle(g_device);
+
+  // release profiling resources
+  vkDestroyQueryPool(g_device, g_statistics_pool, nullptr);
+  vkDestroyQueryPool(g_device, g_timestamp_pool, nullptr);
+
+  // release scene resources
+  release_scene_resources();
+  if (g_instance_edge_buffer.handle)
+    destroy(g_instance_edge_buffer);
+  g_instance_edges.clear();
+
+  // release pipelines
+  vkDestroyPipeline(g_device, g_coefficient_pipeline, nullptr);
+  vkDestroyPipeline(g_device, g_compose_scatter_pipeline, nullptr);
+  vkDestroyPipeline(g_device, g_compose_scan_pipeline, nullptr);
+  vkDestroyPipeline(g_device, g_scan_pipeline, nullptr);
+  vkDestroyPipeline(g_device, g_bin_scatter_pipeline, nullptr);
+  vkDestroyPipeline(g_device, g_bin_count_pipeline, nullptr);
+  vkDestroyPipeline(g_device, g_wr_pipeline, nullptr);
+  for (auto& variant : g_output_variants)
+    vkDestroyPipeline(g_device, variant.pipeline, nullptr);
+  vkDestroyPipelineLayout(g_device, g_wr_pipeline_layout, nullptr);
+  vkDestroyPipelineCache(g_device, g_pipeline_cache, nullptr);
+
+  // release other
+  vkDestroyDescriptorSetLayout(g_device, g_descriptor_set_layout, nullptr);
+  vkDestroyDescriptorPool(g_device, g_descriptor_pool, nullptr);
+  vmaDestroyAllocator(g_allocator);
+  for (auto& frame : g_frames)
+    vkDestroySemaphore(g_device, frame.image_available, nullptr);
+  for (auto& recording : g_recordings)
+  {
+    vkDestroySemaphore(g_device, recording.render_finished, nullptr);
+    vkFreeCommandBuffers(g_device, g_command_pool, 1, &recording.cmd);
+  }
+  vkDestroySemaphore(g_device, g_timeline, nullptr);
+  vkDestroyCommandPool(g_device, g_command_pool, nullptr);
+  for (auto image_view : g_swapchain_image_views)
+    vkDestroyImageView(g_device, image_view, nullptr);
+  vkDestroySwapchainKHR(g_device, g_swapchain, nullptr);
+  g_context_queues.clear();
+  vkDestroyDevice(g_device, nullptr);
+  if (g_windowed)
+    vkDestroySurfaceKHR(g_instance, g_surface, nullptr);
+  if (g_validation)
+    vkDestroyDebugUtilsMessengerEXT(g_instance, g_debug_messenger, nullptr);
+  vkDestroyInstance(g_instance, nullptr);
+  if (g_windowed)
+  {
+    SDL_DestroyWindow(g_window);
+    SDL_Quit();
+  }
+}
+
+VKAPI_ATTR VkBool32 VKAPI_CALL debug_messenger_callback(
+  VkDebugUtilsMessageSeverityFlagBitsEXT      message_severity,
+  VkDebugUtilsMessageTypeFlagsEXT             message_type,
+  VkDebugUtilsMessengerCallbackDataEXT const* callback_data,
+  void*                                       user_data)
+{
+  std::println("{}", callback_data->pMessage);
+  return VK_FALSE;
+}
+
+auto get_debug_info()
+{
+  return VkDebugUtilsMessengerCreateInfoEXT
+  {
+    .sType           = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT,
+    .messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT |
+                       VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
+                       VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
+    .messageType     = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
+                       VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
+                       VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT,
+    .pfnUserCallback = debug_messenger_callback,
+  };
+  
+}
+
+VkResult vkCreateDebugUtilsMessengerEXT(
+  VkInstance                                  instance,
+  VkDebugUtilsMessengerCreateInfoEXT const*   pCreateInfo,
+  VkAllocationCallbacks const*                pAllocator,
+  VkDebugUtilsMessengerEXT*                   pMessenger)
+{
+  auto func = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance,"vkCreateDebugUtilsMessengerEXT");
+  if (func != nullptr) 
+    return func(instance, pCreateInfo, pAllocator, pMessenger);
+  return VK_ERROR_EXTENSION_NOT_PRESENT;
+}
+
+void vkDestroyDebugUtilsMessengerEXT(
+  VkInstance                                  instance,
+  VkDebugUtilsMessengerEXT                    messenger,
+  VkAllocationCallbacks const*                pAllocator)
+{
+  auto func = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkDestroyDebugUtilsMessengerEXT");
+  if (func != nullptr)
+    func(instance, messenger, pAllocator);
+}
+
+// empty when the file does not exist
+auto get_file_data(std::filesystem::path const& path)
+{
+  std::ifstream file(path, std::ios::ate | std::ios::binary);
+  if (!file.is_open())
+    return std::vector<char>();
+
+  auto file_size = (size_t)file.tellg();
+  auto buffer    = std::vector<char>(file_size);
+  
+  file.seekg(0);
+  file.read(buffer.data(), file_size);
+
+  file.close();
+  return buffer;
+}
+
+auto create_shader_module(std::span<uint32_t const> code)
+{
+  VkShaderModuleCreateInfo shader_info
+  {
+    .sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+    .codeSize = code.size_bytes(),
+    .pCode    = code.data(),
+  };
+  VkShaderModule shader_module;
+  check_vk(vkCreateShaderModule(g_device, &shader_info, nullptr, &shader_module));
+  return shader_module;
+}
+
+void write_ppm(std::string_view filename, float const* pixels, VkExtent2D extent)
+{
+  std::ofstream file(filename.data(), std::ios::binary);
+  exit_if(!file.is_open());
+
+  // binary PPM keeps only rgb, alpha is dropped
+  file << "P6\n" << extent.width << ' ' << extent.height << "\n255\n";
+  std::vector<uint8_t> row(extent.width * 3);
+  for (uint32_t y = 0; y < extent.height; ++y)
+  {
+    for (uint32_t x = 0; x < extent.width; ++x)
+    {
+      auto pixel = pixels + (y * extent.width + x) * 4;
+      for (uint32_t c = 0; c < 3; ++c)
+        row[x * 3 + c] = static_cast<uint8_t>(std::clamp(pixel[c], 0.f, 1.f) * 255.f + .5f);
+    }
+    file.write((char*)row.data(), row.size());
+  }
+  file.close();
+}
+
+void transform_image_layout(VkCommandBuffer cmd, VkImage image, VkImageLayout old_layout, VkImageLayout new_layout)
+{
+  VkImageMemoryBarrier barrier
+  {
+    .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+    .srcAccessMask       = VK_ACCESS_MEMORY_WRITE_BIT,
+    .dstAccessMask       = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+    .oldLayout           = old_layout,
+    .newLayout           = new_layout,
+    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+    .image               = image,
+    .subresourceRange     = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 },
+  };
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void memory_barrier(VkCommandBuffer cmd)
+{
+  VkMemoryBarrier barrier
+  {
+    .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+    .srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT,
+    .dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+  };
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+auto create_image(VkFormat format, VkExtent2D extent, VkImageUsageFlags usage)
+{
+  Image image
+  {
+    .format = format,
+    .extent = { extent.width, extent.height, 1 },
+  };
+
+  VkImageCreateInfo image_info
+  {
+    .sType       = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+    .imageType   = VK_IMAGE_TYPE_2D,
+    .format      = image.format,
+    .extent      = image.extent,
+    .mipLevels   = 1,
+    .arrayLayers = 1,
+    .samples     = VK_SAMPLE_COUNT_1_BIT,
+    .tiling      = VK_IMAGE_TILING_OPTIMAL,
+    .usage       = usage,
+  };
+
+  VmaAllocationCreateInfo alloc_info
+  {
+    .flags         = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
+    .usage         = VMA_MEMORY_USAGE_AUTO,
+  };
+  check_vk(vmaCreateImage(g_allocator, &image_info, &alloc_info, &image.handle, &image.allocation, nullptr));
+
+  VkImageViewCreateInfo image_view_info
+  {
+    .sType    = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+    .image    = image.handle,
+    .viewType = VK_IMAGE_VIEW_TYPE_2D,
+    .format   = image.format,
+    .subresourceRange =
+    {
+      .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+      .levelCount = 1,
+      .layerCount = 1,
+    },
+  };
+  check_vk(vkCreateImageView(g_device, &image_view_info, nullptr, &image.view));
+
+  return image;
+}
+
+auto create_buffer(uint32_t size, VkBufferUsageFlags usages, VmaAllocationCreateFlags flags)
+{
+  Buffer buffer;
+
+  VkBufferCreateInfo buf_info
+  {
+    .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+    .size  = size,
+    .usage = usages,
+  };
+  VmaAllocationCreateInfo alloc_info
+  {
+    .flags = flags,
+    .usage = VMA_MEMORY_USAGE_AUTO,
+  };
+  check_vk(vmaCreateBuffer(g_allocator, &buf_info, &alloc_info, &buffer.handle, &buffer.allocation, nullptr));
+
+  return buffer;
+}
+
+auto get_device_address(Buffer const& buffer)
+{
+  VkBufferDeviceAddressInfo info
+  {
+    .sType  = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+    .buffer = buffer.handle,
+  };
+  return vkGetBufferDeviceAddress(g_device, &info);
+}
+
+// formats with an srgb twin, the twins never support storage usage
+auto to_unorm(VkFormat format)
+{
+  switch (format)
+  {
+  case VK_FORMAT_B8G8R8A8_SRGB:         return VK_FORMAT_B8G8R8A8_UNORM;
+  case VK_FORMAT_R8G8B8A8_SRGB:         return VK_FORMAT_R8G8B8A8_UNORM;
+  case VK_FORMAT_A8B8G8R8_SRGB_PACK32:  return VK_FORMAT_A8B8G8R8_UNORM_PACK32;
+  default:                              return format;
+  }
+}
+
+bool supports_format_features(VkFormat format, VkFormatFeatureFlags2 features)
+{
+  VkFormatProperties3 properties3
+  {
+    .sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_3,
+  };
+  VkFormatProperties2 properties
+  {
+    .sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2,
+    .pNext = &properties3,
+  };
+  vkGetPhysicalDeviceFormatProperties2(g_physical_device, format, &properties);
+  return (properties3.optimalTilingFeatures & features) == features;
+}
+
+void blit_image(VkCommandBuffer cmd, VkImage src, VkImage dst, VkExtent2D src_extent, VkExtent2D dst_extent)
+{
+  VkImageBlit2 blit
+  { 
+    .sType = VK_STRUCTURE_TYPE_IMAGE_BLIT_2,
+    .srcSubresource =
+    {
+      .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+      .layerCount = 1,
+    },
+    .dstSubresource =
+    {
+      .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+      .layerCount = 1,
+    },
+  };
+  blit.srcOffsets[1].x = src_extent.width;
+  blit.srcOffsets[1].y = src_extent.height;
+  blit.srcOffsets[1].z = 1;
+  blit.dstOffsets[1].x = dst_extent.width;
+  blit.dstOffsets[1].y = dst_extent.height;
+  blit.dstOffsets[1].z = 1;
+
+  VkBlitImageInfo2 info
+  {
+    .sType          = VK_STRUCTURE_TYPE_BLIT_IMAGE_INFO_2,
+    .srcImage       = src,
+    .srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+    .dstImage       = dst,
+    .dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+    .regionCount    = 1,
+    .pRegions       = &blit,
+    .filter         = VK_FILTER_LINEAR,
+  };
+
+  vkCmdBlitImage2(cmd, &info);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                              init funcs
+////////////////////////////////////////////////////////////////////////////////
+
+void init_SDL()
+{
+  // SDL init
+  SDL_Init(SDL_INIT_VIDEO);
+
+  // create SDL window
+  exit_if(!(g_window = SDL_CreateWindow("SMAA Test", 500, 500, SDL_WINDOW_VULKAN)));
+}
+
+void create_instance()
+{
+  // app info
+  uint32_t instance_version = VK_API_VERSION_1_0;
+  vkEnumerateInstanceVersion(&instance_version);
+  VkApplicationInfo app_info
+  {
+    .sType      = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+    .apiVersion = instance_version,
+  };
+
+  // enable validation layer when it is installed,
+  // CI machines running a CPU driver usually don't have it
+  const char* layers[] = { "VK_LAYER_KHRONOS_validation" };
+  auto debug_info = get_debug_info();
+  uint32_t count;
+  vkEnumerateInstanceLayerProperties(&count, nullptr);
+  std::vector<VkLayerProperties> layer_properties(count);
+  vkEnumerateInstanceLayerProperties(&count, layer_properties.data());
+  g_validation = std::ranges::any_of(layer_properties, [&](auto const& layer) { return std::string_view(layer.layerName) == layers[0]; });
+  
+  // get extensions
+  std::vector<char const*> extensions;
+  if (g_windowed)
+  {
+    auto ret   = SDL_Vulkan_GetInstanceExtensions(&count);
+    extensions = std::vector(ret, ret + count);
+  }
+  if (g_validation)
+    extensions.emplace_back("VK_EXT_debug_utils");
+
+  // create instance
+  VkInstanceCreateInfo instance_info
+  { 
+    .sType                   = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+    .pNext                   = g_validation ? &debug_info : nullptr,
+    .pApplicationInfo        = &app_info,
+    .enabledLayerCount       = g_validation ? 1u : 0u,
+    .ppEnabledLayerNames     = layers,
+    .enabledExtensionCount   = static_cast<uint32_t>(extensions.size()),
+    .ppEnabledExtensionNames = extensions.data(),
+  };
+  check_vk(vkCreateInstance(&instance_info, nullptr, &g_instance));
+}
+
+void create_debug_messenger()
+{
+  auto debug_info = get_debug_info();
+  check_vk(vkCreateDebugUtilsMessengerEXT(g_instance, &debug_info, nullptr, &g_debug_messenger));
+}
+
+void create_surface()
+{
+  exit_if(!SDL_Vulkan_CreateSurface(g_window, g_instance, nullptr, &g_surface));
+}
+
+// coefficients.glsl adds to the blocks with float atomics on buffers
+bool supports_atomic_float_add(VkPhysicalDevice device)
+{
+  uint32_t count;
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &count, nullptr);
+  std::vector<VkExtensionProperties> extensions(count);
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &count, extensions.data());
+  if (!std::ranges::any_of(extensions, [](auto const& extension) { return std::string_view(extension.extensionName) == "VK_EXT_shader_atomic_float"; }))
+    return false;
+
+  VkPhysicalDeviceShaderAtomicFloatFeaturesEXT atomic_float_features
+  {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_ATOMIC_FLOAT_FEATURES_EXT,
+  };
+  VkPhysicalDeviceFeatures2 features2
+  {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+    .pNext = &atomic_float_features,
+  };
+  vkGetPhysicalDeviceFeatures2(device, &features2);
+  return atomic_float_features.shaderBufferFloat32AtomicAdd;
+}
+
+// the first device with float atomics on buffers
+void select_physical_device()
+{
+  uint32_t count;
+  vkEnumeratePhysicalDevices(g_instance, &count, nullptr);
+  std::vector<VkPhysicalDevice> devices(count);
+  vkEnumeratePhysicalDevices(g_instance, &count, devices.data());
+  auto it = std::ranges::find_if(devices, supports_atomic_float_add);
+  exit_if(it == devices.end());
+  g_physical_device = *it;
+}
+
+void create_device_and_get_graphics_queue()
+{
+  // get queue family properties
+  uint32_t count;
+  vkGetPhysicalDeviceQueueFamilyProperties(g_physical_device, &count, nullptr);
+  std::vector<VkQueueFamilyProperties> queue_families(count);
+  vkGetPhysicalDeviceQueueFamilyProperties(g_physical_device, &count, queue_families.data());
+
+  // get graphics queue properties
+  auto it = std::find_if(queue_families.begin(), queue_families.end(), [](VkQueueFamilyProperties const& queue_family) 
+  {
+    return queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+  });
+  exit_if(it == queue_families.end());
+
+  // render contexts submit to a compute only family when there is one,
+  // otherwise to the other queues of the graphics family
+  auto compute = std::find_if(queue_families.begin(), queue_families.end(), [](VkQueueFamilyProperties const& queue_family)
+  {
+    return (queue_family.queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT);
+  });
+  auto has_compute = compute != queue_families.end();
+
+  // set queue infos
+  g_queue_family_index         = static_cast<uint32_t>(std::distance(queue_families.begin(), it));
+  g_context_queue_family_index = has_compute ? static_cast<uint32_t>(std::distance(queue_families.begin(), compute)) : g_queue_family_index;
+  std::vector<float> priorities(std::max(it->queueCount, has_compute ? compute->queueCount : 0u), 1.f);
+  std::vector<VkDeviceQueueCreateInfo> queue_infos
+  {
+    {
+      .sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+      .queueFamilyIndex = g_queue_family_index,
+      .queueCount       = has_compute ? 1 : it->queueCount,
+      .pQueuePriorities = priorities.data(),
+    },
+  };
+  if (has_compute)
+  {
+    queue_infos.push_back(
+    {
+      .sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+      .queueFamilyIndex = g_context_queue_family_index,
+      .queueCount       = compute->queueCount,
+      .pQueuePriorities = priorities.data(),
+    });
+  }
+
+  // the subgroup variant of coefficients.glsl needs ballot and arithmetic
+  // subgroup operations in compute shaders and float atomics on shared memory
+  VkPhysicalDeviceSubgroupProperties subgroup_properties
+  {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES,
+  };
+  VkPhysicalDeviceProperties2 properties2
+  {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+    .pNext = &subgroup_properties,
+  };
+  vkGetPhysicalDeviceProperties2(g_physical_device, &properties2);
+  VkPhysicalDeviceShaderAtomicFloatFeaturesEXT supported_atomic_float_features
+  {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_ATOMIC_FLOAT_FEATURES_EXT,
+  };
+  VkPhysicalDeviceFeatures2 supported_features2
+  {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+    .pNext = &supported_atomic_float_features,
+  };
+  vkGetPhysicalDeviceFeatures2(g_physical_device, &supported_features2);
+  constexpr VkSubgroupFeatureFlags subgroup_operations = VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_ARITHMETIC_BIT | VK_SUBGROUP_FEATURE_BALLOT_BIT;
+  g_subgroup_reduce = (subgroup_properties.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) &&
+                      (subgroup_properties.supportedOperations & subgroup_operations) == subgroup_operations &&
+                      supported_atomic_float_features.shaderSharedFloat32AtomicAdd;
+
+  // features
+  VkPhysicalDeviceShaderAtomicFloatFeaturesEXT atomic_float_features
+  {
+    .sType                        = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_ATOMIC_FLOAT_FEATURES_EXT,
+    .shaderBufferFloat32AtomicAdd = true,
+    .shaderSharedFloat32AtomicAdd = g_subgroup_reduce,
+  };
+  VkPhysicalDeviceVulkan13Features features13
+  { 
+    .sType               = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+    .pNext               = &atomic_float_features, 
+    .synchronization2    = true,
+    .dynamicRendering    = true,
+  };
+  VkPhysicalDeviceVulkan12Features features12
+  { 
+    .sType               = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+    .pNext               = &features13,
+    .timelineSemaphore   = true,
+    .bufferDeviceAddress = true,
+  };
+  VkPhysicalDeviceFeatures supported_features;
+  vkGetPhysicalDeviceFeatures(g_physical_device, &supported_features);
+  VkPhysicalDeviceFeatures2 features2
+  {
+    .sType    = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+    .pNext    = &features12,
+    .features =
+    {
+      .pipelineStatisticsQuery           = supported_features.pipelineStatisticsQuery,
+      .shaderStorageImageExtendedFormats = supported_features.shaderStorageImageExtendedFormats,
+    },
+  };
+
+  // create device
+  // float atomics accumulate the coefficients in coefficients.glsl, backdrops are int
+  std::vector<char const*> extensions { "VK_EXT_shader_atomic_float" };
+  if (g_windowed)
+    extensions.emplace_back("VK_KHR_swapchain");
+  VkDeviceCreateInfo device_info
+  {
+    .sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+    .pNext                   = &features2,
+    .queueCreateInfoCount    = static_cast<uint32_t>(queue_infos.size()),
+    .pQueueCreateInfos       = queue_infos.data(),
+    .enabledExtensionCount   = static_cast<uint32_t>(extensions.size()),
+    .ppEnabledExtensionNames = extensions.data(),
+  };
+  check_vk(vkCreateDevice(g_physical_device, &device_info, nullptr, &g_device));
+
+  // get graphics queue, the contexts get the others
+  vkGetDeviceQueue(g_device, g_queue_family_index, 0, &g_queue);
+  for (uint32_t i = has_compute ? 0 : 1; i < queue_infos.back().queueCount; ++i)
+    vkGetDeviceQueue(g_device, g_context_queue_family_index, i, &g_context_queues.emplace_back().handle);
+}
+
+void init_vma()
+{
+  uint32_t instance_version = VK_API_VERSION_1_0;
+  vkEnumerateInstanceVersion(&instance_version);
+  // not externally synchronized, render contexts allocate on their threads
+  VmaAllocatorCreateInfo allocator_info
+  {
+    .flags            = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT,
+    .physicalDevice   = g_physical_device,
+    .device           = g_device,
+    .instance         = g_instance,
+    .vulkanApiVersion = instance_version,
+  };
+  check_vk(vmaCreateAllocator(&allocator_info, &g_allocator));
+}
+
+void create_swapchain()
+{
+  // get surface capabilities
+  VkSurfaceCapabilitiesKHR  surface_capabilities;
+  vkGetPhysicalDeviceSurfaceCapabilitiesKHR(g_physical_device, g_surface, &surface_capabilities);
+
+  // get surface formats
+  std::vector<VkSurfaceFormatKHR> surface_formats;
+  uint32_t count;
+  vkGetPhysicalDeviceSurfaceFormatsKHR(g_physical_device, g_surface, &count, nullptr);
+  surface_formats.resize(count);
+  vkGetPhysicalDeviceSurfaceFormatsKHR(g_physical_device, g_surface, &count, surface_formats.data());
+
+  // prefer the first format, or its unorm twin, as storage image to skip the blit
+  auto surface_format = surface_formats[0];
+  auto usage          = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  if (surface_capabilities.supportedUsageFlags & VK_IMAGE_USAGE_STORAGE_BIT)
+  {
+    auto it = std::ranges::find_if(surface_formats, [&](VkSurfaceFormatKHR const& format)
+    {
+      return format.colorSpace == surface_format.colorSpace &&
+             (format.format == surface_format.format || format.format == to_unorm(surface_format.format)) &&
+             supports_format_features(format.format, VK_FORMAT_FEATURE_2_STORAGE_IMAGE_BIT | VK_FORMAT_FEATURE_2_STORAGE_WRITE_WITHOUT_FORMAT_BIT);
+    });
+    if (it != surface_formats.end())
+    {
+      g_direct_output = true;
+      g_encode_srgb   = it->format != surface_format.format;
+      surface_format  = *it;
+      usage          |= VK_IMAGE_USAGE_STORAGE_BIT;
+    }
+  }
+
+  // create swapchain
+  VkSwapchainCreateInfoKHR info
+  {
+    .sType            = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
+    .surface          = g_surface,
+    .minImageCount    = surface_capabilities.minImageCount + 1,
+    .imageFormat      = surface_format.format,
+    .imageColorSpace  = surface_format.colorSpace,
+    .imageExtent      = surface_capabilities.currentExtent,
+    .imageArrayLayers = 1,
+    .imageUsage       = usage,
+    .preTransform     = surface_capabilities.currentTransform,
+    .compositeAlpha   = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
+    .presentMode      = VK_PRESENT_MODE_FIFO_KHR,
+    .clipped          = VK_TRUE,
+  };
+  check_vk(vkCreateSwapchainKHR(g_device, &info, nullptr, &g_swapchain));
+
+  // get swapchain images
+  vkGetSwapchainImagesKHR(g_device, g_swapchain, &g_swapchain_image_count, nullptr);
+  g_swapchain_images.resize(g_swapchain_image_count);
+  vkGetSwapchainImagesKHR(g_device, g_swapchain, &g_swapchain_image_count, g_swapchain_images.data());
+
+  // create image views
+  g_swapchain_image_views.resize(g_swapchain_image_count);
+  for (size_t i = 0; i < g_swapchain_image_count; ++i)
+  {
+    VkImageViewCreateInfo info
+    {
+      .sType            = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+      .image            = g_swapchain_images[i],
+      .viewType         = VK_IMAGE_VIEW_TYPE_2D,
+      .format           = surface_format.format,
+      .components       = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A },
+      .subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 },
+    };
+    check_vk(vkCreateImageView(g_device, &info, nullptr, &g_swapchain_image_views[i]));
+  }
+
+  // set swapchain image format
+  g_swapchain_image_format = surface_format.format;
+  // get swapchain extent
+  g_swapchain_extent = surface_capabilities.currentExtent;
+}
+
+void create_command_pool()
+{
+  VkCommandPoolCreateInfo info
+  {
+    .sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+    .flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+    .queueFamilyIndex = g_queue_family_index,
+  };
+  check_vk(vkCreateCommandPool(g_device, &info, nullptr, &g_command_pool));
+}
+
+void init_frames()
+{
+  VkSemaphoreCreateInfo semaphore_info
+  {
+    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+  };
+
+  // acquire needs binary semaphores, one per frame slot
+  g_frames.resize(g_frames_in_flight);
+  if (g_windowed)
+    for (auto& frame : g_frames)
+      check_vk(vkCreateSemaphore(g_device, &semaphore_info, nullptr, &frame.image_available));
+
+  // present keeps waiting on render_finished, so it belongs to the swapchain image
+  g_recordings.resize(g_windowed ? g_swapchain_image_count : g_frames_in_flight);
+  for (auto& recording : g_recordings)
+  {
+    VkCommandBufferAllocateInfo cmd_info
+    {
+      .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+      .commandPool        = g_command_pool,
+      .level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+      .commandBufferCount  = 1,
+    };
+    check_vk(vkAllocateCommandBuffers(g_device, &cmd_info, &recording.cmd));
+    if (g_windowed)
+      check_vk(vkCreateSemaphore(g_device, &semaphore_info, nullptr, &recording.render_finished));
+  }
+
+  VkSemaphoreTypeCreateInfo type_info
+  {
+    .sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+    .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+  };
+  VkSemaphoreCreateInfo timeline_info
+  {
+    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+    .pNext = &type_info,
+  };
+  check_vk(vkCreateSemaphore(g_device, &timeline_info, nullptr, &g_timeline));
+}
+
+void create_query_pools()
+{
+  // timestamps need support on the queue family
+  uint32_t count;
+  vkGetPhysicalDeviceQueueFamilyProperties(g_physical_device, &count, nullptr);
+  std::vector<VkQueueFamilyProperties> queue_families(count);
+  vkGetPhysicalDeviceQueueFamilyProperties(g_physical_device, &count, queue_families.data());
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(g_physical_device, &properties);
+  if (!queue_families[g_queue_family_index].timestampValidBits)
+    return;
+  g_timestamp_period = properties.limits.timestampPeriod;
+
+  // pass boundaries, one more than passes per frame
+  VkQueryPoolCreateInfo timestamp_info
+  {
+    .sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+    .queryType  = VK_QUERY_TYPE_TIMESTAMP,
+    .queryCount = static_cast<uint32_t>(g_recordings.size()) * (pass_count + 1),
+  };
+  check_vk(vkCreateQueryPool(g_device, &timestamp_info, nullptr, &g_timestamp_pool));
+
+  VkPhysicalDeviceFeatures features;
+  vkGetPhysicalDeviceFeatures(g_physical_device, &features);
+  if (!features.pipelineStatisticsQuery)
+    return;
+  VkQueryPoolCreateInfo statistics_info
+  {
+    .sType              = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+    .queryType          = VK_QUERY_TYPE_PIPELINE_STATISTICS,
+    .queryCount         = static_cast<uint32_t>(g_recordings.size()) * compute_pass_count,
+    .pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT,
+  };
+  check_vk(vkCreateQueryPool(g_device, &statistics_info, nullptr, &g_statistics_pool));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                              scene funcs
+////////////////////////////////////////////////////////////////////////////////
+
+void add_line(glm::vec2 p0, glm::vec2 p1)
+{
+  g_edges.push_back({ .p0 = p0, .p1 = p1, .type = EdgeType::line });
+}
+
+// append a closed polygon, the last point is connected back to the first
+void add_polygon(std::vector<glm::vec2> const& points)
+{
+  for (size_t i = 0; i < points.size(); ++i)
+    add_line(points[i], points[(i + 1) % points.size()]);
+}
+
+// split a bezier segment at t by de casteljau,
+// returns the first part and leaves the second part in points
+template <size_t N>
+auto split_bezier(std::array<glm::vec2, N>& points, float t)
+{
+  std::array<glm::vec2, N> first;
+  auto p = points;
+  for (size_t i = 0; i < N; ++i)
+  {
+    first[i]          = p[0];
+    points[N - 1 - i] = p[N - 1 - i];
+    for (size_t j = 0; j + 1 < N - i; ++j)
+      p[j] = glm::mix(p[j], p[j + 1], t);
+  }
+  return first;
+}
+
+// parameters in (0, 1) where x or y of a bezier segment has an extremum,
+// at most two per axis, kept off the heap as loaders add millions of segments
+template <size_t N>
+auto bezier_extrema(std::array<glm::vec2, N> const& p)
+{
+  std::array<float, 4> ts;
+  size_t count = 0;
+  auto add = [&](float t) { if (t > 0.f && t < 1.f) ts[count++] = t; };
+  for (int axis = 0; axis < 2; ++axis)
+  {
+    if constexpr (N == 3)
+    {
+      // derivative is linear
+      auto b = p[0][axis] - 2.f * p[1][axis] + p[2][axis];
+      if (b != 0.f)
+        add((p[0][axis] - p[1][axis]) / b);
+    }
+    else
+    {
+      // derivative / 3 = a t^2 + 2 b t + c
+      auto a = p[3][axis] - p[0][axis] + 3.f * (p[1][axis] - p[2][axis]);
+      auto b = p[0][axis] - 2.f * p[1][axis] + p[2][axis];
+      auto c = p[1][axis] - p[0][axis];
+      if (std::abs(a) < 1e-6f)
+      {
+        if (b != 0.f)
+          add(-c / (2.f * b));
+      }
+      else if (auto disc = b * b - a * c; disc >= 0.f)
+      {
+        add((-b - std::sqrt(disc)) / a);
+        add((-b + std::sqrt(disc)) / a);
+      }
+    }
+  }
+  std::sort(ts.begin(), ts.begin() + count);
+  return std::pair(ts, count);
+}
+
+// calls push with the x and y monotone pieces of a bezier segment in order
+template <size_t N, typename F>
+void split_monotone(std::array<glm::vec2, N> points, F const& push)
+{
+  auto prev        = 0.f;
+  auto [ts, count] = bezier_extrema(points);
+  for (size_t i = 0; i < count; ++i)
+  {
+    push(split_bezier(points, (ts[i] - prev) / (1.f - prev)));
+    prev = ts[i];
+  }
+  push(points);
+}
+
+template <size_t N>
+Edge to_edge(std::array<glm::vec2, N> const& p)
+{
+  if constexpr (N == 3)
+    return { .p0 = p[0], .p1 = p[1], .p2 = p[2], .type = EdgeType::quadratic };
+  else
+    return { .p0 = p[0], .p1 = p[1], .p2 = p[2], .p3 = p[3], .type = EdgeType::cubic };
+}
+
+// append a quadratic (N = 3) or cubic (N = 4) bezier segment,
+// it is split into x and y monotone pieces as the shader expects
+template <size_t N>
+void add_bezier(std::array<glm::vec2, N> points)
+{
+  static_assert(N == 3 || N == 4);
+  split_monotone(points, [](std::array<glm::vec2, N> const& p) { g_edges.push_back(to_edge(p)); });
+}
+
+template void add_bezier<3>(std::array<glm::vec2, 3> points);
+template void add_bezier<4>(std::array<glm::vec2, 4> points);
+
+size_t get_monotone_pieces(Edge const& edge, std::array<Edge, max_monotone_pieces>& pieces)
+{
+  size_t count = 0;
+  auto   push  = [&](auto const& p) { pieces[count++] = to_edge(p); };
+  switch (edge.type)
+  {
+  case EdgeType::line:
+    pieces[count++] = edge;
+    break;
+  case EdgeType::quadratic:
+    split_monotone(std::array{ edge.p0, edge.p1, edge.p2 }, push);
+    break;
+  default:
+    split_monotone(std::array{ edge.p0, edge.p1, edge.p2, edge.p3 }, push);
+  }
+  return count;
+}
+
+// circle from four cubic arcs
+void add_circle(glm::vec2 center, float radius, bool clockwise)
+{
+  auto k = .5522847f * radius;
+  auto s = clockwise ? -1.f : 1.f;
+  for (int i = 0; i < 4; ++i)
+  {
+    // rotate the first quadrant arc by i * 90 degrees
+    auto rotate = [&](glm::vec2 v)
+    {
+      for (int j = 0; j < i; ++j)
+        v = { -v.y, v.x };
+      return center + glm::vec2(v.x, s * v.y);
+    };
+    add_bezier<4>({ rotate({ radius, 0.f }), rotate({ radius, k }), rotate({ k, radius }), rotate({ 0.f, radius }) });
+  }
+}
+
+// elliptical arc in svg endpoint notation from cubics of at most 90 degrees,
+// radii too small to reach p1 are scaled up as svg does
+void add_arc(glm::vec2 p0, glm::vec2 radius, float rotation, bool large_arc, bool sweep, glm::vec2 p1)
+{
+  if (p0 == p1)
+    return;
+  radius = glm::abs(radius);
+  if (radius.x == 0.f || radius.y == 0.f)
+  {
+    add_line(p0, p1);
+    return;
+  }
+
+  // center of the ellipse in the frame rotated by -rotation
+  auto c      = std::cos(rotation);
+  auto s      = std::sin(rotation);
+  auto half   = (p0 - p1) * .5f;
+  auto p      = glm::vec2(c * half.x + s * half.y, -s * half.x + c * half.y);
+  auto lambda = p.x * p.x / (radius.x * radius.x) + p.y * p.y / (radius.y * radius.y);
+  if (lambda > 1.f)
+    radius *= std::sqrt(lambda);
+  auto rx2    = radius.x * radius.x;
+  auto ry2    = radius.y * radius.y;
+  auto k      = std::sqrt(std::max((rx2 * ry2 - rx2 * p.y * p.y - ry2 * p.x * p.x) / (rx2 * p.y * p.y + ry2 * p.x * p.x), 0.f));
+  auto cp     = (large_arc == sweep ? -k : k) * glm::vec2(radius.x * p.y / radius.y, -radius.y * p.x / radius.x);
+  auto center = glm::vec2(c * cp.x - s * cp.y, s * cp.x + c * cp.y) + (p0 + p1) * .5f;
+
+  // start angle and sweep
+  auto angle = [](glm::vec2 u, glm::vec2 v) { return std::atan2(u.x * v.y - u.y * v.x, glm::dot(u, v)); };
+  auto u     = (p - cp) / radius;
+  auto v     = (-p - cp) / radius;
+  auto theta = angle({ 1.f, 0.f }, u);
+  auto delta = angle(u, v);
+  if (!sweep && delta > 0.f)
+    delta -= 2.f * glm::pi<float>();
+  else if (sweep && delta < 0.f)
+    delta += 2.f * glm::pi<float>();
+
+  auto count   = std::max(static_cast<int>(std::ceil(std::abs(delta) / glm::half_pi<float>() - 1e-4f)), 1);
+  auto step    = delta / count;
+  auto handle  = 4.f / 3.f * std::tan(step / 4.f);
+  auto at      = [&](float a) { auto e = radius * glm::vec2(std::cos(a), std::sin(a)); return center + glm::vec2(c * e.x - s * e.y, s * e.x + c * e.y); };
+  auto tangent = [&](float a) { auto e = radius * glm::vec2(-std::sin(a), std::cos(a)); return glm::vec2(c * e.x - s * e.y, s * e.x + c * e.y); };
+  auto beg     = p0;
+  for (int i = 0; i < count; ++i)
+  {
+    auto a0  = theta + step * i;
+    auto a1  = a0 + step;
+    auto end = i + 1 == count ? p1 : at(a1);
+    add_bezier<4>({ beg, beg + handle * tangent(a0), end - handle * tangent(a1), end });
+    beg = end;
+  }
+}
+
+std::vector<glm::vec2> regular_polygon(glm::vec2 center, float outer_radius, float inner_radius, uint32_t count, bool clockwise)
+{
+  std::vector<glm::vec2> points(count);
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    auto angle  = 2.f * glm::pi<float>() * i / count * (clockwise ? -1.f : 1.f);
+    auto radius = i % 2 ? inner_radius : outer_radius;
+    points[i]   = center + radius * glm::vec2(std::cos(angle), std::sin(angle));
+  }
+  return points;
+}
+
+void create_demo_scene(VkExtent2D extent)
+{
+  auto size = glm::vec2(extent.width, extent.height);
+  auto unit = std::min(size.x, size.y);
+
+  // star
+  add_polygon(regular_polygon(size * glm::vec2(.3f, .5f), unit * .25f, unit * .1f, 10));
+
+  // ring of cubic arcs, the inner circle runs the other way to cut a hole
+  add_circle(size * glm::vec2(.7f, .5f), unit * .2f);
+  add_circle(size * glm::vec2(.7f, .5f), unit * .1f, true);
+
+  // leaf of two quadratics
+  auto beg = size * glm::vec2(.6f, .85f);
+  auto end = size * glm::vec2(.8f, .85f);
+  add_bezier<3>({ beg, size * glm::vec2(.7f, .75f), end });
+  add_bezier<3>({ end, size * glm::vec2(.7f, .95f), beg });
+}
+
+void add_layer(Paint const& paint)
+{
+  g_layers.push_back({ static_cast<uint32_t>(g_edges.size()), paint });
+}
+
+void create_layer_demo_scene(VkExtent2D extent, uint32_t count)
+{
+  auto size = glm::vec2(extent.width, extent.height);
+  auto unit = std::min(size.x, size.y);
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> uniform(0.f, 1.f);
+  auto color = [&](float alpha) { return glm::vec4(uniform(random), uniform(random), uniform(random), alpha); };
+
+  g_edges.clear();
+  g_layers.clear();
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    auto center = size * glm::vec2(uniform(random), uniform(random));
+    auto radius = unit * (.05f + .15f * uniform(random));
+    auto type   = static_cast<PaintType>(i % 3);
+    add_layer(
+    {
+      .type   = type,
+      .color0 = color(.4f + .6f * uniform(random)),
+      .color1 = color(type == PaintType::radial ? 0.f : 1.f),
+      .p0     = type == PaintType::linear ? center - radius : center,
+      .p1     = center + radius,
+    });
+
+    // stars and rings, the inner circle runs the other way to cut a hole
+    if (i % 2)
+      add_polygon(regular_polygon(center, radius, radius * .4f, 5 + i % 4));
+    else
+    {
+      add_circle(center, radius);
+      add_circle(center, radius * .5f, true);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                        Wavelet Rasterization Resource Init
+////////////////////////////////////////////////////////////////////////////////
+
+void create_descriptor_resources()
+{
+  // the image is the only descriptor, one set per swapchain image when writing into them
+  g_descriptor_sets.resize(g_direct_output ? g_swapchain_image_count : 1);
+  auto set_count = static_cast<uint32_t>(g_descriptor_sets.size());
+
+  // create descriptor pool
+  VkDescriptorPoolSize pool_sizes[]
+  {
+    { .type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = set_count },
+  };
+  VkDescriptorPoolCreateInfo pool_info
+  {
+    .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+    .maxSets       = set_count,
+    .poolSizeCount = static_cast<uint32_t>(std::size(pool_sizes)),
+    .pPoolSizes    = pool_sizes,
+  };
+  check_vk(vkCreateDescriptorPool(g_device, &pool_info, nullptr, &g_descriptor_pool));
+
+  // create descriptor set layout
+  VkDescriptorSetLayoutBinding bindings[]
+  {
+    { .binding = 0, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT },
+  };
+  VkDescriptorSetLayoutCreateInfo layout_info
+  {
+    .sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+    .bindingCount = static_cast<uint32_t>(std::size(bindings)),
+    .pBindings    = bindings,
+  };
+  check_vk(vkCreateDescriptorSetLayout(g_device, &layout_info, nullptr, &g_descriptor_set_layout));
+
+  // allocate descriptor sets
+  std::vector<VkDescriptorSetLayout> set_layouts(set_count, g_descriptor_set_layout);
+  VkDescriptorSetAllocateInfo alloc_info
+  {
+    .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+    .descriptorPool     = g_descriptor_pool,
+    .descriptorSetCount = set_count,
+    .pSetLayouts        = set_layouts.data(),
+  };
+  check_vk(vkAllocateDescriptorSets(g_device, &alloc_info, g_descriptor_sets.data()));
+}
+
+// point the descriptor set at the resources of the current scene
+void update_descriptor_set(VkDescriptorSet descriptor_set, VkImageView image_view)
+{
+  VkDescriptorImageInfo image_info
+  {
+    .sampler     = VK_NULL_HANDLE,
+    .imageView   = image_view,
+    .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+  };
+  VkWriteDescriptorSet write_info
+  {
+    .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+    .dstSet          = descriptor_set,
+    .dstBinding      = 0,
+    .descriptorCount = 1,
+    .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+    .pImageInfo      = &image_info,
+  };
+  vkUpdateDescriptorSets(g_device, 1, &write_info, 0, nullptr);
+}
+
+void update_descriptor_sets()
+{
+  for (uint32_t i = 0; i < g_descriptor_sets.size(); ++i)
+    update_descriptor_set(g_descriptor_sets[i], g_direct_output ? g_swapchain_image_views[i] : g_wr_image.view);
+}
+
+// a slot holds the edges of a batch followed by its dirty tiles, its layers and
+// its instances, buffer references are 16 byte aligned unless declared otherwise
+auto get_dirty_tile_offset(size_t edge_count)
+{
+  return static_cast<VkDeviceSize>((std::max<size_t>(edge_count, 1) * sizeof(Edge) + 15) / 16 * 16);
+}
+
+auto get_layer_offset(size_t edge_count, size_t dirty_tile_count)
+{
+  return (get_dirty_tile_offset(edge_count) + dirty_tile_count * sizeof(uint32_t) + 15) / 16 * 16;
+}
+
+auto get_instance_offset(size_t edge_count, size_t dirty_tile_count, size_t layer_count)
+{
+  return (get_layer_offset(edge_count, dirty_tile_count) + layer_count * sizeof(LayerInfo) + 15) / 16 * 16;
+}
+
+auto get_slot_size(size_t edge_count, size_t dirty_tile_count, size_t layer_count, size_t instance_count = 0)
+{
+  if (!instance_count)
+    return get_layer_offset(edge_count, dirty_tile_count) + layer_count * sizeof(LayerInfo);
+  return get_instance_offset(edge_count, dirty_tile_count, layer_count) + instance_header_size + instance_count * sizeof(InstanceInfo);
+}
+
+// the bytes of its slot a batch uses
+auto get_batch_size(Batch const& batch)
+{
+  return get_slot_size(batch.edges.size(), batch.dirty_tiles.size(), batch.layers.size(), batch.instances.size());
+}
+
+// the edges the bin pass runs over
+auto get_edge_count(Batch const& batch)
+{
+  return batch.instances.empty() ? static_cast<uint32_t>(batch.edges.size()) : batch.instance_edge_count;
+}
+
+// slot_count slots of slot_size bytes, one per recording
+void create_upload_resources(UploadResources& upload, VkDeviceSize slot_size, size_t slot_count)
+{
+  upload.slot_size  = slot_size;
+  upload.slot_count = slot_count;
+  auto size         = upload.slot_size * upload.slot_count;
+  exit_if(size > UINT32_MAX);
+
+  // vma picks host visible device memory (rebar, bar or unified memory) when there is some
+  upload.ring = create_buffer(static_cast<uint32_t>(size), VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+    VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_ALLOW_TRANSFER_INSTEAD_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+  VmaAllocationInfo info;
+  vmaGetAllocationInfo(g_allocator, upload.ring.allocation, &info);
+  upload.data = static_cast<std::byte*>(info.pMappedData);
+
+  VkMemoryPropertyFlags memory_properties;
+  vmaGetAllocationMemoryProperties(g_allocator, upload.ring.allocation, &memory_properties);
+  upload.staging = !(memory_properties & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  if (upload.staging)
+    upload.edge_buffer = create_buffer(static_cast<uint32_t>(size), VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, 0);
+}
+
+void release_upload_resources(UploadResources& upload)
+{
+  if (upload.edge_buffer.handle)
+    destroy(upload.edge_buffer);
+  destroy(upload.ring);
+  upload.data = nullptr;
+}
+
+// copy edges and give every closed contour the coarse levels of its footprint, edges
+// of open chains keep all levels, since only all of them together are closed
+void copy_with_lod(std::span<Edge const> edges, float lod_threshold, Edge* dst)
+{
+  for (size_t beg = 0; beg < edges.size();)
+  {
+    // monotone edges lie inside the bounds of their end points
+    auto start  = edges[beg].p0;
+    auto min    = start;
+    auto max    = start;
+    auto end    = beg;
+    auto closed = false;
+    while (end < edges.size())
+    {
+      auto p = get_end(edges[end++]);
+      min = glm::min(min, p);
+      max = glm::max(max, p);
+      if (p == start)
+      {
+        closed = true;
+        break;
+      }
+      if (end < edges.size() && edges[end].p0 != p)
+        break;
+    }
+
+    uint32_t coarse_levels = 0;
+    auto     footprint     = std::max(max.x - min.x, max.y - min.y);
+    while (closed && coarse_levels < static_cast<uint32_t>(tile_levels) && footprint < lod_threshold / static_cast<float>(1 << coarse_levels))
+      ++coarse_levels;
+    for (; beg < end; ++beg)
+    {
+      auto edge = edges[beg];
+      edge.coarse_levels = coarse_levels;
+      dst[beg] = edge;
+    }
+  }
+}
+
+// write the batch into a slot whose last submission is done, edges may be in it already,
+// lod_threshold is g_lod_threshold or the one of a render context
+void upload_batch(UploadResources const& upload, uint32_t slot, Batch const& batch, float lod_threshold)
+{
+  auto offset       = upload.slot_size * slot;
+  auto dirty_offset = get_dirty_tile_offset(batch.edges.size());
+  auto layer_offset = get_layer_offset(batch.edges.size(), batch.dirty_tiles.size());
+  auto dst          = reinterpret_cast<Edge*>(upload.data + offset);
+  // preprocessed edges were written into the slot already
+  if (batch.edges.data() != dst)
+  {
+    if (lod_threshold > 0.f)
+      copy_with_lod(batch.edges, lod_threshold, dst);
+    else
+      std::memcpy(dst, batch.edges.data(), batch.edges.size_bytes());
+  }
+  std::memcpy(upload.data + offset + dirty_offset, batch.dirty_tiles.data(), batch.dirty_tiles.size_bytes());
+  std::memcpy(upload.data + offset + layer_offset, batch.layers.data(), batch.layers.size_bytes());
+  if (!batch.instances.empty())
+  {
+    auto instance_offset = offset + get_instance_offset(batch.edges.size(), batch.dirty_tiles.size(), batch.layers.size());
+    auto instance_count  = static_cast<uint32_t>(batch.instances.size());
+    std::memcpy(upload.data + instance_offset, &instance_count, sizeof(instance_count));
+    std::memcpy(upload.data + instance_offset + instance_header_size, batch.instances.data(), batch.instances.size_bytes());
+  }
+  check_vk(vmaFlushAllocation(g_allocator, upload.ring.allocation, offset, get_batch_size(batch)));
+}
+
+// min and max of the control points, curves stay inside them
+auto get_control_bounds(Edge const& edge)
+{
+  glm::vec2 points[] = { edge.p0, edge.p1, edge.p2, edge.p3 };
+  auto point_count   = edge.type == EdgeType::line ? 2 : edge.type == EdgeType::quadratic ? 3 : 4;
+  auto min           = points[0];
+  auto max           = points[0];
+  for (int i = 1; i < point_count; ++i)
+  {
+    min = glm::min(min, points[i]);
+    max = glm::max(max, points[i]);
+  }
+  return std::pair(min, max);
+}
+
+// the layers of a batch in infos, without layers all edges are one layer over the
+// grid, otherwise a layer has the tiles its edges overlap and the tiles between
+// them and the right border, which edges right of the image add their height to,
+// edges left of the image add to no tile
+void compute_layer_infos(std::span<Edge const> edges, std::span<Layer const> layers, VkExtent2D tile_count, std::vector<LayerInfo>& infos)
+{
+  auto grid = glm::ivec2(tile_count.width, tile_count.height);
+  infos.clear();
+  if (layers.empty())
+  {
+    infos.push_back({ .tile_extent = grid });
+    return;
+  }
+
+  uint32_t first_tile = 0;
+  uint32_t first_row  = 0;
+  for (size_t i = 0; i < layers.size(); ++i)
+  {
+    auto const& layer = layers[i];
+    auto end_edge     = i + 1 < layers.size() ? layers[i + 1].first_edge : edges.size();
+    exit_if(layer.first_edge > end_edge || end_edge > edges.size());
+
+    auto min = grid;
+    auto max = glm::ivec2(-1);
+    for (auto const& edge : edges.subspan(layer.first_edge, end_edge - layer.first_edge))
+    {
+      auto [lo, hi] = get_control_bounds(edge);
+      lo = glm::floor(lo / static_cast<float>(tile_size));
+      hi = glm::floor(hi / static_cast<float>(tile_size));
+      if (hi.x < 0.f || hi.y < 0.f || lo.y >= grid.y)
+        continue;
+      min = glm::min(min, glm::ivec2(glm::clamp(lo, glm::vec2(0.f), glm::vec2(grid - 1))));
+      max = glm::max(max, glm::ivec2(glm::clamp(hi, glm::vec2(0.f), glm::vec2(grid - 1))));
+    }
+    auto empty = max.x < min.x;
+    infos.push_back(
+    {
+      .color0      = layer.paint.color0,
+      .color1      = layer.paint.color1,
+      .p0          = layer.paint.p0,
+      .p1          = layer.paint.p1,
+      .paint_type  = layer.paint.type,
+      .first_edge  = layer.first_edge,
+      .first_tile  = first_tile,
+      .first_row   = first_row,
+      .tile_min    = empty ? glm::ivec2(0) : min,
+      .tile_extent = empty ? glm::ivec2(0) : max - min + 1,
+    });
+    auto extent = infos.back().tile_extent;
+    first_tile += static_cast<uint32_t>(extent.x * extent.y);
+    first_row  += static_cast<uint32_t>(extent.y);
+  }
+}
+
+// the bin capacities of a batch with the layers of compute_layer_infos, or of
+// instances placing ranges of edges, which are a single layer over the grid,
+// bin.glsl only visits tiles inside the control point bounds
+auto compute_bin_capacities(std::span<Edge const> edges, std::span<LayerInfo const> layers, VkExtent2D grid, std::span<Instance const> instances = {})
+{
+  auto const& last = layers.back();
+  auto tile_count  = static_cast<size_t>(last.first_tile) + static_cast<size_t>(last.tile_extent.x) * last.tile_extent.y;
+  auto row_count   = static_cast<size_t>(last.first_row) + last.tile_extent.y;
+
+  size_t capacity = 0;
+  std::vector<bool> touched(tile_count);
+  auto add_tiles = [&](Edge const& edge, glm::vec2 offset, LayerInfo const& layer)
+  {
+    auto [min, max] = get_control_bounds(edge);
+    auto beg = glm::max(glm::floor((min + offset) / static_cast<float>(tile_size)), glm::vec2(0.f));
+    auto end = glm::min(glm::floor((max + offset) / static_cast<float>(tile_size)), glm::vec2(grid.width - 1, grid.height - 1));
+    if (beg.x > end.x || beg.y > end.y)
+      return;
+    capacity += static_cast<size_t>(end.x - beg.x + 1) * static_cast<size_t>(end.y - beg.y + 1);
+    for (auto y = static_cast<int>(beg.y); y <= static_cast<int>(end.y); ++y)
+      for (auto x = static_cast<int>(beg.x); x <= static_cast<int>(end.x); ++x)
+        touched[layer.first_tile + (y - layer.tile_min.y) * layer.tile_extent.x + (x - layer.tile_min.x)] = true;
+  };
+  for (auto const& instance : instances)
+    for (auto const& edge : edges.subspan(instance.first_edge, instance.edge_count))
+      add_tiles(edge, instance.origin, layers[0]);
+  for (size_t i = 0; i < layers.size() && instances.empty(); ++i)
+  {
+    auto const& layer = layers[i];
+    auto end_edge     = i + 1 < layers.size() ? layers[i + 1].first_edge : edges.size();
+    for (auto const& edge : edges.subspan(layer.first_edge, end_edge - layer.first_edge))
+      add_tiles(edge, glm::vec2(0.f), layer);
+  }
+  // buffer sizes are 32 bit
+  exit_if(capacity * sizeof(TileEdge) > UINT32_MAX || tile_count * sizeof(Tile) > UINT32_MAX);
+  return BinCapacities
+  {
+    .tile_edges  = static_cast<uint32_t>(std::max<size_t>(capacity, 1)),
+    .blocks      = static_cast<uint32_t>(std::max<size_t>(std::ranges::count(touched, true), 1)),
+    .layer_tiles = static_cast<uint32_t>(std::max<size_t>(tile_count, 1)),
+    .layer_rows  = static_cast<uint32_t>(row_count),
+  };
+}
+
+constexpr VkBufferUsageFlags bin_usage = VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+// the buffers sized by the tiles of the layers
+void create_layer_tile_resources(BinResources& bin)
+{
+  bin.tiles      = create_buffer(bin.capacities.layer_tiles * sizeof(Tile), bin_usage, 0);
+  // one extra column per row of a layer for edges right of it
+  bin.backdrops  = create_buffer((bin.capacities.layer_tiles + bin.capacities.layer_rows) * sizeof(int32_t), bin_usage, 0);
+  bin.layer_list = create_buffer(bin.capacities.layer_tiles * sizeof(uint32_t), bin_usage, 0);
+}
+
+void release_layer_tile_resources(BinResources& bin)
+{
+  destroy(bin.layer_list);
+  destroy(bin.backdrops);
+  destroy(bin.tiles);
+}
+
+// blocks only for tiles some edge may touch, the rest is constant
+void create_bin_resources(BinResources& bin)
+{
+  create_layer_tile_resources(bin);
+  bin.tile_edges  = create_buffer(bin.capacities.tile_edges * sizeof(TileEdge), bin_usage, 0);
+  bin.tile_layers = create_buffer(bin.tile_count.width * bin.tile_count.height * sizeof(TileLayers), bin_usage, 0);
+  // scan.glsl writes the groups of the passes after binning
+  bin.counters    = create_buffer(sizeof(Counters), bin_usage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, 0);
+  bin.blocks      = create_buffer(bin.capacities.blocks * block_size * sizeof(float), bin_usage, 0);
+}
+
+void release_bin_resources(BinResources& bin)
+{
+  destroy(bin.blocks);
+  destroy(bin.counters);
+  destroy(bin.tile_layers);
+  destroy(bin.tile_edges);
+  release_layer_tile_resources(bin);
+}
+
+// make room for a batch needing required and upload slots of slot_size, capacities
+// only grow, so scenes changing every frame settle without reallocations, wait
+// returns once no submission uses the buffers anymore, the new addresses are
+// pushed once recordings record again
+void reserve_resources(BinResources& bin, UploadResources& upload, BinCapacities const& required, VkDeviceSize slot_size, std::function<void()> const& wait)
+{
+  auto& capacities      = bin.capacities;
+  auto grow_tile_edges  = required.tile_edges > capacities.tile_edges;
+  auto grow_blocks      = required.blocks > capacities.blocks;
+  auto grow_layer_tiles = required.layer_tiles > capacities.layer_tiles || required.layer_rows > capacities.layer_rows;
+  auto grow_upload      = slot_size > upload.slot_size;
+  if (!grow_tile_edges && !grow_blocks && !grow_layer_tiles && !grow_upload)
+    return;
+
+  wait();
+  capacities.tile_edges  = std::max(capacities.tile_edges, required.tile_edges);
+  capacities.blocks      = std::max(capacities.blocks, required.blocks);
+  capacities.layer_tiles = std::max(capacities.layer_tiles, required.layer_tiles);
+  capacities.layer_rows  = std::max(capacities.layer_rows, required.layer_rows);
+  if (grow_layer_tiles)
+  {
+    release_layer_tile_resources(bin);
+    create_layer_tile_resources(bin);
+  }
+  if (grow_tile_edges)
+  {
+    destroy(bin.tile_edges);
+    bin.tile_edges = create_buffer(capacities.tile_edges * sizeof(TileEdge), bin_usage, 0);
+  }
+  if (grow_blocks)
+  {
+    destroy(bin.blocks);
+    bin.blocks = create_buffer(capacities.blocks * block_size * sizeof(float), bin_usage, 0);
+  }
+  if (grow_upload)
+  {
+    auto slot_count = upload.slot_count;
+    release_upload_resources(upload);
+    create_upload_resources(upload, slot_size * 2, slot_count);
+  }
+}
+
+// the cache file is named after the device uuid and driver version,
+// so a driver update or another gpu starts with an empty cache
+void create_pipeline_cache()
+{
+  VkPhysicalDeviceIDProperties id_properties
+  {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES,
+  };
+  VkPhysicalDeviceProperties2 properties
+  {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+    .pNext = &id_properties,
+  };
+  vkGetPhysicalDeviceProperties2(g_physical_device, &properties);
+
+  std::string name = "pipeline_cache_";
+  for (auto byte : id_properties.deviceUUID)
+    name += std::format("{:02x}", byte);
+  name += std::format("_{:08x}.bin", properties.properties.driverVersion);
+
+  // per user directory, falls back to the working directory
+  auto dir = SDL_GetPrefPath("wavelet", "wavelet_rasterization");
+  g_pipeline_cache_path = std::filesystem::path(dir ? dir : "") / name;
+  SDL_free(dir);
+
+  // the driver checks the header as well, a blob of another device is dropped here already
+  auto data   = get_file_data(g_pipeline_cache_path);
+  auto header = reinterpret_cast<VkPipelineCacheHeaderVersionOne const*>(data.data());
+  if (data.size() < sizeof(VkPipelineCacheHeaderVersionOne) ||
+      !std::equal(std::begin(header->pipelineCacheUUID), std::end(header->pipelineCacheUUID), properties.properties.pipelineCacheUUID))
+    data.clear();
+  g_pipeline_cache_loaded_size = data.size();
+
+  VkPipelineCacheCreateInfo cache_info
+  {
+    .sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+    .initialDataSize = data.size(),
+    .pInitialData    = data.data(),
+  };
+  check_vk(vkCreatePipelineCache(g_device, &cache_info, nullptr, &g_pipeline_cache));
+}
+
+// write through a temporary file, concurrent runs never see a partial blob
+void save_pipeline_cache()
+{
+  size_t size;
+  check_vk(vkGetPipelineCacheData(g_device, g_pipeline_cache, &size, nullptr));
+  if (size == g_pipeline_cache_loaded_size)
+    return;
+  std::vector<char> data(size);
+  check_vk(vkGetPipelineCacheData(g_device, g_pipeline_cache, &size, data.data()));
+
+  auto tmp_path = g_pipeline_cache_path;
+  tmp_path += std::format(".{:08x}.tmp", std::random_device()());
+  {
+    std::ofstream file(tmp_path, std::ios::binary);
+    if (!file.write(data.data(), size))
+      return;
+  }
+  std::error_code error;
+  std::filesystem::rename(tmp_path, g_pipeline_cache_path, error);
+  if (error)
+    std::filesystem::remove(tmp_path, error);
+  else
+    g_pipeline_cache_loaded_size = size;
+}
+
+auto create_compute_pipeline(std::span<uint32_t const> code, VkSpecializationInfo const* specialization_info = nullptr)
+{
+  VkPipelineShaderStageCreateInfo shader_info
+  {
+    .sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+    .stage               = VK_SHADER_STAGE_COMPUTE_BIT,
+    .module              = create_shader_module(code),
+    .pName               = "main",
+    .pSpecializationInfo = specialization_info,
+  };
+  VkComputePipelineCreateInfo pipeline_info
+  {
+    .sType  = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+    .stage  = shader_info,
+    .layout = g_wr_pipeline_layout,
+  };
+  VkPipeline pipeline;
+  check_vk(vkCreateComputePipelines(g_device, g_pipeline_cache, 1, &pipeline_info, nullptr, &pipeline));
+  vkDestroyShaderModule(g_device, shader_info.module, nullptr);
+  return pipeline;
+}
+
+// r8 and r16f are extended storage formats
+bool supports_output_format(VkFormat format)
+{
+  VkPhysicalDeviceFeatures features;
+  vkGetPhysicalDeviceFeatures(g_physical_device, &features);
+  return supports_format_features(format, VK_FORMAT_FEATURE_2_STORAGE_IMAGE_BIT) &&
+         (!get_output_variant(format).extended || features.shaderStorageImageExtendedFormats);
+}
+
+// the reconstruct pipeline writing format, created when a target first uses it
+auto get_output_pipeline(VkFormat format)
+{
+  auto& variant = get_output_variant(format);
+  exit_if(!supports_output_format(format));
+  if (!variant.pipeline)
+  {
+    variant.pipeline = create_compute_pipeline(variant.code);
+    save_pipeline_cache();
+  }
+  return variant.pipeline;
+}
+
+// render funcs
+void wait_timeline(uint64_t value);
+
+// the instance table of g_instances, instances are numbered on from first_index
+void compute_instance_infos()
+{
+  g_instance_infos.clear();
+  g_instance_edge_count = 0;
+  for (auto const& instance : g_instances)
+  {
+    exit_if(instance.first_edge + static_cast<size_t>(instance.edge_count) > g_instance_edges.size());
+    g_instance_infos.push_back({ .origin = instance.origin, .first_edge = instance.first_edge, .first_index = g_instance_edge_count });
+    g_instance_edge_count += instance.edge_count;
+  }
+}
+
+// the bin capacities of a frame batch, retained coefficients stay in place however the paths move
+auto get_frame_capacities(std::span<Edge const> edges)
+{
+  exit_if(!g_instances.empty() && (g_retained || !g_layers.empty() || !edges.empty()));
+  compute_layer_infos(edges, g_layers, g_bin.tile_count, g_layer_infos);
+  compute_instance_infos();
+  if (!g_instances.empty())
+    return compute_bin_capacities(g_instance_edges, g_layer_infos, g_bin.tile_count, g_instances);
+  auto capacities = compute_bin_capacities(edges, g_layer_infos, g_bin.tile_count);
+  if (g_retained)
+    capacities.blocks = g_bin.tile_count.width * g_bin.tile_count.height;
+  return capacities;
+}
+
+void create_scene_resources(VkExtent2D extent, VkFormat format)
+{
+  // create image, only its extent is used when the swapchain images are written directly
+  if (g_direct_output)
+  {
+    assert(extent.width == g_swapchain_extent.width && extent.height == g_swapchain_extent.height);
+    g_wr_image = { .format = g_swapchain_image_format, .extent = { extent.width, extent.height, 1 } };
+  }
+  else
+  {
+    get_output_pipeline(format);
+    g_wr_image = create_image(format, extent, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+  }
+
+  // size buffers for the scene, recordings upload it before their next submission,
+  // retained scenes are a single layer over the grid
+  g_bin.tile_count = { (extent.width + tile_size - 1) / tile_size, (extent.height + tile_size - 1) / tile_size };
+  g_bin.capacities = get_frame_capacities(g_edges);
+  create_bin_resources(g_bin);
+  if (g_retained)
+    g_tile_backdrop_buffer = create_buffer((g_bin.tile_count.width + 1) * g_bin.tile_count.height * sizeof(int32_t), bin_usage, 0);
+  create_upload_resources(g_upload, get_slot_size(g_edges.size(), 0, g_layer_infos.size(), g_instance_infos.size()), g_recordings.size());
+  update_descriptor_sets();
+  g_rebuild = true;
+  ++g_scene_version;
+}
+
+// make room for a batch of edges and dirty tiles, every submission may use the
+// old buffers, retained blocks never grow and keep their coefficients
+void reserve_capacities(std::span<Edge const> edges, size_t dirty_tile_count)
+{
+  auto capacities = get_frame_capacities(edges);
+  auto slot_size  = get_slot_size(edges.size(), dirty_tile_count, g_layer_infos.size(), g_instance_infos.size());
+  reserve_resources(g_bin, g_upload, capacities, slot_size, [] { wait_timeline(g_timeline_value); });
+}
+
+void update_scene()
+{
+  reserve_capacities(g_edges, 0);
+  ++g_scene_version;
+}
+
+void release_scene_resources()
+{
+  if (!g_upload.ring.handle)
+    return;
+  if (g_frame_consumer)
+    end_frame_readback();
+  wait_timeline(g_timeline_value);
+  if (g_readback_buffer.handle)
+    destroy(g_readback_buffer);
+  if (g_tile_backdrop_buffer.handle)
+    destroy(g_tile_backdrop_buffer);
+  release_bin_resources(g_bin);
+  release_upload_resources(g_upload);
+  if (g_wr_image.handle)
+    destroy(g_wr_image);
+  g_wr_image = {};
+  g_edges.clear();
+  g_layers.clear();
+  g_instances.clear();
+}
+
+void init_wr(bool scene)
+{
+  // create descriptor resources
+  create_descriptor_resources();
+
+  // create pipeline layout, buffers are pushed as addresses
+  VkPushConstantRange push_constant_range
+  {
+    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+    .size       = sizeof(PushConstants),
+  };
+  VkPipelineLayoutCreateInfo layout_info
+  {
+    .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+    .setLayoutCount         = 1,
+    .pSetLayouts            = &g_descriptor_set_layout,
+    .pushConstantRangeCount = 1,
+    .pPushConstantRanges    = &push_constant_range,
+  };
+  check_vk(vkCreatePipelineLayout(g_device, &layout_info, nullptr, &g_wr_pipeline_layout));
+
+  // create compute pipelines, count and scatter share bin.spv, scan and scatter compose.spv
+  VkBool32 scatter = VK_TRUE;
+  VkSpecializationMapEntry scatter_entry
+  {
+    .constantID = 0,
+    .offset     = 0,
+    .size       = sizeof(VkBool32),
+  };
+  VkSpecializationInfo scatter_info
+  {
+    .mapEntryCount = 1,
+    .pMapEntries   = &scatter_entry,
+    .dataSize      = sizeof(VkBool32),
+    .pData         = &scatter,
+  };
+  // the same layout switches on the srgb encoding of shader.spv
+  auto encode_srgb_info = scatter_info;
+  create_pipeline_cache();
+  g_bin_count_pipeline       = create_compute_pipeline(bin_spv);
+  g_bin_scatter_pipeline     = create_compute_pipeline(bin_spv, &scatter_info);
+  g_scan_pipeline            = create_compute_pipeline(scan_spv);
+  g_compose_scan_pipeline    = create_compute_pipeline(compose_spv);
+  g_compose_scatter_pipeline = create_compute_pipeline(compose_spv, &scatter_info);
+  g_coefficient_pipeline     = create_compute_pipeline(g_subgroup_reduce ? coefficients_subgroup_spv : coefficients_spv);
+  if (g_direct_output)
+    g_wr_pipeline            = create_compute_pipeline(shader_spv, g_encode_srgb ? &encode_srgb_info : nullptr);
+  save_pipeline_cache();
+
+  // start with the demo scene, a single path of a retained scene
+  if (!scene)
+    return;
+  auto extent = g_windowed ? g_swapchain_extent : g_headless_extent;
+  create_demo_scene(extent);
+  if (g_retained)
+    set_path(0, g_edges);
+  create_scene_resources(extent);
+}
+
+// the vulkan objects and the passes, the window ones only if window
+void init_device(bool window, bool scene)
+{
+  // vulkan init
+  g_windowed = window;
+  create_instance();
+  if (g_validation)
+    create_debug_messenger();
+  if (g_windowed)
+    create_surface();
+  select_physical_device();
+  create_device_and_get_graphics_queue();
+  if (g_windowed)
+    create_swapchain();
+  create_command_pool();
+  init_frames();
+  create_query_pools();
+  init_vma();
+  
+  // init wavelet rasterization
+  init_wr(scene);
+}
+
+void init_vk(bool scene)
+{
+  init_device(!g_headless, scene);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                              profiling funcs
+////////////////////////////////////////////////////////////////////////////////
+
+// reset the queries of a recording and mark the start of its first pass,
+// every recording owns a slice of the pools
+void begin_frame_queries(VkCommandBuffer cmd, uint32_t recording_index)
+{
+  g_query_frame = recording_index;
+  if (!g_timestamp_pool)
+    return;
+  vkCmdResetQueryPool(cmd, g_timestamp_pool, recording_index * (pass_count + 1), pass_count + 1);
+  if (g_statistics_pool)
+    vkCmdResetQueryPool(cmd, g_statistics_pool, recording_index * compute_pass_count, compute_pass_count);
+  vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, g_timestamp_pool, recording_index * (pass_count + 1));
+}
+
+void begin_pass(VkCommandBuffer cmd, Pass pass)
+{
+  if (g_statistics_pool && pass < compute_pass_count)
+    vkCmdBeginQuery(cmd, g_statistics_pool, g_query_frame * compute_pass_count + pass, 0);
+}
+
+// passes run back to back, so the end of one pass is the start of the next
+void end_pass(VkCommandBuffer cmd, Pass pass)
+{
+  if (g_statistics_pool && pass < compute_pass_count)
+    vkCmdEndQuery(cmd, g_statistics_pool, g_query_frame * compute_pass_count + pass);
+  if (g_timestamp_pool)
+    vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, g_timestamp_pool, g_query_frame * (pass_count + 1) + pass + 1);
+}
+
+// read the results of a recording whose last submission is done, never waits
+void collect_frame_queries(uint32_t recording_index)
+{
+  auto& recording = g_recordings[recording_index];
+  if (!g_timestamp_pool || !recording.queries_pending)
+    return;
+  recording.queries_pending = false;
+
+  // value and availability pairs, passes which were not recorded stay unavailable
+  std::array<uint64_t, (pass_count + 1) * 2> timestamps{};
+  vkGetQueryPoolResults(g_device, g_timestamp_pool, recording_index * (pass_count + 1), pass_count + 1,
+    sizeof(timestamps), timestamps.data(), 2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+  std::array<uint64_t, compute_pass_count * 2> invocations{};
+  if (g_statistics_pool)
+    vkGetQueryPoolResults(g_device, g_statistics_pool, recording_index * compute_pass_count, compute_pass_count,
+      sizeof(invocations), invocations.data(), 2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+  for (uint32_t pass = 0; pass < pass_count; ++pass)
+  {
+    if (!timestamps[pass * 2 + 1] || !timestamps[pass * 2 + 3])
+      continue;
+    auto ms = (timestamps[pass * 2 + 2] - timestamps[pass * 2]) * g_timestamp_period * 1e-6;
+
+    auto& times = g_pass_times[pass];
+    if (times.samples.size() < profile_window)
+      times.samples.push_back(ms);
+    else
+      times.samples[times.next] = ms;
+    times.next = (times.next + 1) % profile_window;
+
+    if (g_profile_csv.is_open())
+    {
+      auto has_invocations = pass < compute_pass_count && invocations[pass * 2 + 1];
+      g_profile_csv << g_profiled_frame_count << ',' << pass_names[pass] << ',' << ms << ',';
+      if (has_invocations)
+        g_profile_csv << invocations[pass * 2];
+      g_profile_csv << '\n';
+    }
+  }
+  ++g_profiled_frame_count;
+}
+
+// read the queries of all recordings, only valid once the queue is idle
+void collect_pending_queries()
+{
+  for (uint32_t i = 0; i < g_recordings.size(); ++i)
+    collect_frame_queries(i);
+}
+
+void reset_pass_stats()
+{
+  collect_pending_queries();
+  g_pass_times = {};
+}
+
+// statistics over the last profile_window frames
+PassStats get_pass_stats(Pass pass)
+{
+  auto samples = g_pass_times[pass].samples;
+  if (samples.empty())
+    return PassStats{};
+  auto p99 = samples.begin() + (samples.size() - 1) * 99 / 100;
+  std::nth_element(samples.begin(), p99, samples.end());
+  return PassStats
+  {
+    .min = *std::ranges::min_element(samples),
+    .avg = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size(),
+    .p99 = *p99,
+  };
+}
+
+void print_pass_stats()
+{
+  collect_pending_queries();
+  for (uint32_t pass = 0; pass < pass_count; ++pass)
+  {
+    if (g_pass_times[pass].samples.empty())
+      continue;
+    auto stats = get_pass_stats(static_cast<Pass>(pass));
+    std::println("{:<12} min {:8.3f} ms  avg {:8.3f} ms  p99 {:8.3f} ms", pass_names[pass], stats.min, stats.avg, stats.p99);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                              render funcs
+////////////////////////////////////////////////////////////////////////////////
+
+// the slot of an upload ring as the shaders read it, without rebar they read a
+// device local copy of the first size bytes
+auto prepare_upload_slot(VkCommandBuffer cmd, UploadResources const& upload, uint32_t slot, VkDeviceSize size)
+{
+  auto offset = upload.slot_size * slot;
+  if (upload.staging)
+  {
+    VkBufferCopy region
+    {
+      .srcOffset = offset,
+      .dstOffset = offset,
+      .size      = size,
+    };
+    vkCmdCopyBuffer(cmd, upload.ring.handle, upload.edge_buffer.handle, 1, &region);
+    memory_barrier(cmd);
+  }
+  return get_device_address(upload.staging ? upload.edge_buffer : upload.ring) + offset;
+}
+
+// all kernels share the layout, so the constants stay for every dispatch,
+// only retained batches read the tile backdrops, render contexts pass none
+auto get_push_constants(BinResources const& bin, VkDeviceAddress slot_address, VkDeviceAddress tile_backdrops, Batch const& batch, uint32_t dirty_tile_count, uint32_t flags)
+{
+  auto instanced = !batch.instances.empty();
+  return PushConstants
+  {
+    .edges              = instanced ? batch.instance_edges : slot_address,
+    .tiles              = get_device_address(bin.tiles),
+    .tile_edges         = get_device_address(bin.tile_edges),
+    .backdrops          = get_device_address(bin.backdrops),
+    .counters           = get_device_address(bin.counters),
+    .blocks             = get_device_address(bin.blocks),
+    .tile_backdrops     = tile_backdrops,
+    .dirty_tiles        = slot_address + get_dirty_tile_offset(batch.edges.size()),
+    .layers             = slot_address + get_layer_offset(batch.edges.size(), batch.dirty_tiles.size()),
+    .tile_layers        = get_device_address(bin.tile_layers),
+    .layer_list         = get_device_address(bin.layer_list),
+    .instances          = instanced ? slot_address + get_instance_offset(batch.edges.size(), batch.dirty_tiles.size(), batch.layers.size()) : 0,
+    .tile_count         = bin.tile_count,
+    .edge_count         = get_edge_count(batch),
+    .tile_edge_capacity = bin.capacities.tile_edges,
+    .block_capacity     = bin.capacities.blocks,
+    .dirty_tile_count   = dirty_tile_count,
+    .flags              = flags | (instanced ? instanced_flag : 0),
+    .layer_count        = static_cast<uint32_t>(batch.layers.size()),
+  };
+}
+
+void dispatch_bin(VkCommandBuffer cmd, BinResources const& bin, Batch const& batch, bool composite)
+{
+  auto edge_group_count = (get_edge_count(batch) + 255) / 256;
+
+  // clear counts, backdrops and coefficients, accumulating batches add to the coefficients
+  vkCmdFillBuffer(cmd, bin.tiles.handle, 0, VK_WHOLE_SIZE, 0);
+  vkCmdFillBuffer(cmd, bin.backdrops.handle, 0, VK_WHOLE_SIZE, 0);
+  if (!batch.accumulate)
+    vkCmdFillBuffer(cmd, bin.blocks.handle, 0, VK_WHOLE_SIZE, 0);
+  if (composite)
+    vkCmdFillBuffer(cmd, bin.tile_layers.handle, 0, VK_WHOLE_SIZE, 0);
+  memory_barrier(cmd);
+
+  // count edges per tile
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, g_bin_count_pipeline);
+  vkCmdDispatch(cmd, edge_group_count, 1, 1);
+  memory_barrier(cmd);
+
+  // prefix sum counts to offsets
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, g_scan_pipeline);
+  vkCmdDispatch(cmd, 1, 1, 1);
+  memory_barrier(cmd);
+
+  // scatter edge indices into tile lists
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, g_bin_scatter_pipeline);
+  vkCmdDispatch(cmd, edge_group_count, 1, 1);
+  memory_barrier(cmd);
+
+  // list the layers of every tile of the image, scan.glsl counted them
+  if (composite)
+  {
+    auto const& last       = batch.layers.back();
+    auto layer_tile_count  = last.first_tile + static_cast<uint32_t>(last.tile_extent.x * last.tile_extent.y);
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, g_compose_scan_pipeline);
+    vkCmdDispatch(cmd, 1, 1, 1);
+    memory_barrier(cmd);
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, g_compose_scatter_pipeline);
+    vkCmdDispatch(cmd, (layer_tile_count + 255) / 256, 1, 1);
+    memory_barrier(cmd);
+  }
+}
+
+// accumulate coefficients of every tile list entry
+void dispatch_coefficients(VkCommandBuffer cmd, BinResources const& bin)
+{
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, g_coefficient_pipeline);
+  vkCmdDispatchIndirect(cmd, bin.counters.handle, offsetof(Counters, coefficient_groups));
+  memory_barrier(cmd);
+}
+
+// scan.glsl sized the dispatch to the tiles which are not empty, clear gives the
+// others a coverage of 0, the image is in general layout and the pipeline bound
+void dispatch_reconstruct(VkCommandBuffer cmd, BinResources const& bin, VkImage image, bool clear)
+{
+  if (clear)
+  {
+    VkClearColorValue       clear_value = { .float32 = { 0.f, 0.f, 0.f, 1.f } };
+    VkImageSubresourceRange range       = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    vkCmdClearColorImage(cmd, image, VK_IMAGE_LAYOUT_GENERAL, &clear_value, 1, &range);
+    memory_barrier(cmd);
+  }
+  vkCmdDispatchIndirect(cmd, bin.counters.handle, offsetof(Counters, reconstruct_groups));
+}
+
+// render the batch in upload slot i into g_wr_image, or swapchain image i when writing it directly
+void dispatch_wr(VkCommandBuffer cmd, uint32_t i, Batch const& batch)
+{
+  auto descriptor_set = g_direct_output ? g_descriptor_sets[i] : g_descriptor_sets[0];
+  auto image          = g_direct_output ? g_swapchain_images[i] : g_wr_image.handle;
+  // every swapchain image needs all its tiles
+  auto dirty_only     = batch.reconstruct == Reconstruct::dirty && !g_direct_output;
+  auto dirty_count    = dirty_only ? static_cast<uint32_t>(batch.dirty_tiles.size()) : 0u;
+  auto composite      = !g_layers.empty();
+  auto flags          = (g_retained ? retained_flag : 0) | (batch.accumulate ? accumulate_flag : 0) | (composite ? composite_flag : 0);
+
+  // the previous submission may still read what this one clears
+  memory_barrier(cmd);
+
+  auto slot_address   = prepare_upload_slot(cmd, g_upload, i, get_batch_size(batch));
+  auto tile_backdrops = g_retained ? get_device_address(g_tile_backdrop_buffer) : 0;
+  auto push_constants = get_push_constants(g_bin, slot_address, tile_backdrops, batch, dirty_count, flags);
+  vkCmdPushConstants(cmd, g_wr_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants), &push_constants);
+  begin_pass(cmd, pass_bin);
+  dispatch_bin(cmd, g_bin, batch, composite);
+  end_pass(cmd, pass_bin);
+
+  begin_pass(cmd, pass_coefficients);
+  dispatch_coefficients(cmd, g_bin);
+  end_pass(cmd, pass_coefficients);
+
+  // reconstruct one tile per workgroup, only the dirty ones keep the other pixels of g_wr_image
+  if (batch.reconstruct == Reconstruct::none && !g_direct_output)
+    return;
+  begin_pass(cmd, pass_reconstruct);
+  transform_image_layout(cmd, image, dirty_only ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, g_wr_pipeline_layout, 0, 1, &descriptor_set, 0, nullptr);
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, g_direct_output ? g_wr_pipeline : get_output_variant(g_wr_image.format).pipeline);
+  // retained scenes reconstruct every tile they do not skip
+  if (dirty_count)
+    vkCmdDispatch(cmd, dirty_count, 1, 1);
+  else
+    dispatch_reconstruct(cmd, g_bin, image, !g_retained);
+  end_pass(cmd, pass_reconstruct);
+}
+
+// copy image into buffer and make it visible to the host, the image stays in general layout
+void record_readback(VkCommandBuffer cmd, Image const& image, Buffer const& buffer)
+{
+  transform_image_layout(cmd, image.handle, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+  VkBufferImageCopy region
+  {
+    .imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 },
+    .imageExtent      = image.extent,
+  };
+  vkCmdCopyImageToBuffer(cmd, image.handle, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer.handle, 1, &region);
+  transform_image_layout(cmd, image.handle, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL);
+
+  // make transfer writes visible to host
+  VkMemoryBarrier barrier
+  {
+    .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+    .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+    .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+  };
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+auto get_readback_size(Image const& image = g_wr_image)
+{
+  return image.extent.width * image.extent.height * get_output_variant(image.format).pixel_size;
+}
+
+// record the commands of a recording, only again once the scene changed
+void record_commands(uint32_t i, Batch const& batch)
+{
+  auto& recording = g_recordings[i];
+  auto  cmd       = recording.cmd;
+  check_vk(vkResetCommandBuffer(cmd, 0));
+  VkCommandBufferBeginInfo beg_info
+  {
+    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+  };
+  vkBeginCommandBuffer(cmd, &beg_info);
+  begin_frame_queries(cmd, i);
+
+  // retained changes without dirty tiles are off screen and leave g_wr_image as it is
+  if (batch.reconstruct != Reconstruct::dirty || !batch.dirty_tiles.empty() || g_direct_output)
+    dispatch_wr(cmd, i, batch);
+
+  // the reconstruct pass wrote the swapchain image already
+  if (g_direct_output)
+    transform_image_layout(cmd, g_swapchain_images[i], VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+  // copy rendered image to swapchain image i, there is none when headless
+  else if (g_windowed)
+  {
+    begin_pass(cmd, pass_blit);
+    transform_image_layout(cmd, g_wr_image.handle, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+    transform_image_layout(cmd, g_swapchain_images[i], VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    blit_image(cmd, g_wr_image.handle, g_swapchain_images[i], { g_wr_image.extent.width, g_wr_image.extent.height }, g_swapchain_extent);
+    end_pass(cmd, pass_blit);
+
+    // retained frames only write the dirty tiles of it next time
+    transform_image_layout(cmd, g_wr_image.handle, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL);
+
+    // transform sawpchain image to present layout
+    transform_image_layout(cmd, g_swapchain_images[i], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+  }
+
+  // the frame goes to the host in the same submission, chunks without reconstruct are no frames
+  recording.readback = g_frame_consumer && batch.reconstruct != Reconstruct::none;
+  if (recording.readback)
+    record_readback(cmd, g_wr_image, g_frame_readbacks[i].buffer);
+  vkEndCommandBuffer(cmd);
+}
+
+void wait_semaphore(VkSemaphore semaphore, uint64_t value)
+{
+  VkSemaphoreWaitInfo wait_info
+  {
+    .sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+    .semaphoreCount = 1,
+    .pSemaphores    = &semaphore,
+    .pValues        = &value,
+  };
+  check_vk(vkWaitSemaphores(g_device, &wait_info, UINT64_MAX));
+}
+
+void wait_timeline(uint64_t value)
+{
+  wait_semaphore(g_timeline, value);
+}
+
+// submit a command buffer which signals the next timeline value, returns that value
+auto submit(VkCommandBuffer cmd, VkSemaphore wait_semaphore = VK_NULL_HANDLE, VkSemaphore signal_semaphore = VK_NULL_HANDLE)
+{
+  VkCommandBufferSubmitInfo cmd_submit_info
+  {
+    .sType         = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+    .commandBuffer = cmd,
+  };
+  // only the blit needs the swapchain image, the compute passes start right away,
+  // unless they write the swapchain image themselves
+  VkSemaphoreSubmitInfo wait_sem_submit_info
+  {
+    .sType     = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+    .semaphore = wait_semaphore,
+    .stageMask = g_direct_output ? VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT,
+  };
+  VkSemaphoreSubmitInfo signal_sem_submit_infos[]
+  {
+    {
+      .sType     = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+      .semaphore = g_timeline,
+      .value     = ++g_timeline_value,
+      .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+    },
+    {
+      .sType     = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+      .semaphore = signal_semaphore,
+      .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+    },
+  };
+
+  VkSubmitInfo2 submit_info
+  {
+    .sType                    = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+    .waitSemaphoreInfoCount   = wait_semaphore ? 1u : 0u,
+    .pWaitSemaphoreInfos      = &wait_sem_submit_info,
+    .commandBufferInfoCount   = 1,
+    .pCommandBufferInfos      = &cmd_submit_info,
+    .signalSemaphoreInfoCount = signal_semaphore ? 2u : 1u,
+    .pSignalSemaphoreInfos    = signal_sem_submit_infos,
+  };
+  std::lock_guard lock(g_queue_mutex);
+  check_vk(vkQueueSubmit2(g_queue, 1, &submit_info, VK_NULL_HANDLE));
+  return g_timeline_value;
+}
+
+// the changes of the retained scene since the last frame, or all its paths when a rebuild is due
+Batch get_retained_batch()
+{
+  auto delta      = take_scene_delta();
+  auto tile_count = g_bin.tile_count;
+  auto tile_total = tile_count.width * tile_count.height;
+
+  // an edge changes the tiles it overlaps and the backdrops of the tiles left of it
+  std::vector<bool> dirty(tile_total);
+  g_dirty_tiles.clear();
+  for (auto bounds : delta.bounds)
+  {
+    auto beg = glm::floor(glm::vec2(bounds.x, bounds.y) / static_cast<float>(tile_size));
+    auto end = glm::floor(glm::vec2(bounds.z, bounds.w) / static_cast<float>(tile_size));
+    if (end.x < 0.f || end.y < 0.f || beg.y >= tile_count.height)
+      continue;
+    auto row_beg = static_cast<uint32_t>(std::max(beg.y, 0.f));
+    auto row_end = static_cast<uint32_t>(std::min(end.y, tile_count.height - 1.f));
+    auto col_end = static_cast<uint32_t>(std::min(end.x, tile_count.width - 1.f));
+    for (auto row = row_beg; row <= row_end; ++row)
+      for (uint32_t col = 0; col <= col_end; ++col)
+      {
+        auto tile = row * tile_count.width + col;
+        if (!dirty[tile])
+        {
+          dirty[tile] = true;
+          g_dirty_tiles.push_back(tile);
+        }
+      }
+  }
+
+  // past half the tiles the full grid is as cheap, workgroup counts are at least 65535 in x
+  auto rebuild = g_rebuild || delta.rebuild || g_frames_since_rebuild >= rebuild_interval ||
+                 g_dirty_tiles.size() > std::min(tile_total / 2, 65535u);
+  if (rebuild)
+  {
+    gather_path_edges();
+    g_rebuild              = false;
+    g_frames_since_rebuild = 0;
+    return { .edges = g_edges, .layers = g_layer_infos };
+  }
+  if (!delta.edges.empty())
+    ++g_frames_since_rebuild;
+  g_delta_edges = std::move(delta.edges);
+  return { .edges = g_delta_edges, .layers = g_layer_infos, .dirty_tiles = g_dirty_tiles, .accumulate = true, .reconstruct = Reconstruct::dirty };
+}
+
+// wait until the previous submission of a recording is done and its frame consumed, so it can be reused
+void acquire_recording(uint32_t recording_index)
+{
+  if (g_frame_consumer)
+  {
+    std::unique_lock lock(g_frame_readback_mutex);
+    g_frame_readback_cv.wait(lock, [&] { return !g_frame_readbacks_busy[recording_index]; });
+  }
+  wait_timeline(g_recordings[recording_index].timeline_value);
+  collect_frame_queries(recording_index);
+}
+
+void submit_commands(uint32_t recording_index, VkSemaphore wait_semaphore = VK_NULL_HANDLE)
+{
+  auto& recording = g_recordings[recording_index];
+  recording.timeline_value  = submit(recording.cmd, wait_semaphore, recording.render_finished);
+  recording.queries_pending = true;
+
+  // the worker waits for the frame, not this thread
+  if (recording.readback)
+  {
+    std::lock_guard lock(g_frame_readback_mutex);
+    g_frame_readbacks_busy[recording_index] = true;
+    g_pending_frames.push_back({ recording_index, recording.timeline_value, g_frames_read_back++ });
+    g_frame_readback_cv.notify_all();
+  }
+}
+
+// submit the recording, recorded again if it is behind the scene
+void submit_recording(uint32_t recording_index, VkSemaphore wait_semaphore = VK_NULL_HANDLE)
+{
+  auto& recording = g_recordings[recording_index];
+  acquire_recording(recording_index);
+
+  // the slot and commands of the recording are free again,
+  // retained batches apply once and are recorded every frame
+  if (g_retained)
+  {
+    auto batch = get_retained_batch();
+    reserve_capacities(batch.edges, batch.dirty_tiles.size());
+    upload_batch(g_upload, recording_index, batch, g_lod_threshold);
+    record_commands(recording_index, batch);
+  }
+  else if (recording.scene_version != g_scene_version)
+  {
+    Batch batch = { .edges = g_edges, .layers = g_layer_infos };
+    if (!g_instance_infos.empty())
+    {
+      batch.instances           = g_instance_infos;
+      batch.instance_edges      = get_device_address(g_instance_edge_buffer);
+      batch.instance_edge_count = g_instance_edge_count;
+    }
+    upload_batch(g_upload, recording_index, batch, g_lod_threshold);
+    record_commands(recording_index, batch);
+    recording.scene_version = g_scene_version;
+  }
+  submit_commands(recording_index, wait_semaphore);
+}
+
+void render()
+{
+  // the frame which used this slot before is done after the wait
+  auto& frame = g_frames[g_frame_index];
+  if (g_timeline_value >= g_frames_in_flight)
+    wait_timeline(g_timeline_value + 1 - g_frames_in_flight);
+
+  // acquire next image
+  uint32_t image_index;
+  check_vk(vkAcquireNextImageKHR(g_device, g_swapchain, UINT64_MAX, frame.image_available, VK_NULL_HANDLE, &image_index));
+
+  // commands of the image are recorded already
+  submit_recording(image_index, frame.image_available);
+
+  // present
+  VkPresentInfoKHR present_info
+  {
+    .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+    .waitSemaphoreCount = 1,
+    .pWaitSemaphores    = &g_recordings[image_index].render_finished,
+    .swapchainCount     = 1,
+    .pSwapchains        = &g_swapchain,
+    .pImageIndices      = &image_index,
+  };
+  {
+    std::lock_guard lock(g_queue_mutex);
+    check_vk(vkQueuePresentKHR(g_queue, &present_info));
+  }
+
+  // next frame
+  g_frame_index = (g_frame_index + 1) % g_frames_in_flight;
+}
+
+void render_headless()
+{
+  // one recording per frame slot, waits for the frame submitted g_frames_in_flight frames ago
+  submit_recording(g_frame_index);
+  g_frame_index = (g_frame_index + 1) % g_frames_in_flight;
+}
+
+void begin_stream()
+{
+  // the stream replaces the retained paths, it lasts until the next rebuild
+  exit_if(!g_retained || g_windowed);
+  clear_paths();
+  take_scene_delta();
+  g_edges.clear();
+  g_rebuild              = false;
+  g_frames_since_rebuild = 0;
+  g_stream_chunk_index   = 0;
+}
+
+// record and submit the chunk waiting in the upload slot of the current frame,
+// only the last one reconstructs g_wr_image
+void submit_stream_chunk(bool last)
+{
+  auto i     = g_frame_index;
+  auto edges = std::span(reinterpret_cast<Edge const*>(g_upload.data + g_upload.slot_size * i), g_stream_edge_count);
+  record_commands(i,
+  {
+    .edges       = edges,
+    .layers      = g_layer_infos,
+    .accumulate  = g_stream_chunk_index > 0,
+    .reconstruct = last ? Reconstruct::all : Reconstruct::none,
+  });
+  submit_commands(i);
+  g_stream_pending = false;
+  ++g_stream_chunk_index;
+  g_frame_index = (g_frame_index + 1) % g_frames_in_flight;
+}
+
+void stream_chunk(std::span<Edge const> edges)
+{
+  if (g_stream_pending)
+    submit_stream_chunk(false);
+
+  // the slot of the frame is free once its previous submission is done
+  acquire_recording(g_frame_index);
+  reserve_capacities(edges, 0);
+  upload_batch(g_upload, g_frame_index, { .edges = edges, .layers = g_layer_infos }, g_lod_threshold);
+  g_stream_pending    = true;
+  g_stream_edge_count = static_cast<uint32_t>(edges.size());
+}
+
+void stream_chunk(std::span<Edge const> edges, Transform const& transform)
+{
+  if (g_stream_pending)
+    submit_stream_chunk(false);
+
+  // the first pass counts what the second one writes, streams are retained,
+  // so the blocks cover the grid
+  acquire_recording(g_frame_index);
+  auto tile_count = g_bin.tile_count;
+  auto plan       = plan_preprocess(edges, transform, { g_wr_image.extent.width, g_wr_image.extent.height });
+  auto edge_count = plan.offsets.back();
+  exit_if(plan.tile_edge_count * sizeof(TileEdge) > UINT32_MAX);
+  BinCapacities capacities
+  {
+    .tile_edges  = static_cast<uint32_t>(std::max<size_t>(plan.tile_edge_count, 1)),
+    .blocks      = tile_count.width * tile_count.height,
+    .layer_tiles = tile_count.width * tile_count.height,
+    .layer_rows  = tile_count.height,
+  };
+  reserve_resources(g_bin, g_upload, capacities, get_slot_size(edge_count, 0, g_layer_infos.size()), [] { wait_timeline(g_timeline_value); });
+
+  // the workers write their chunks into the slot, upload_batch adds the layers
+  auto slot = reinterpret_cast<Edge*>(g_upload.data + g_upload.slot_size * g_frame_index);
+  write_preprocessed(plan, slot);
+  upload_batch(g_upload, g_frame_index, { .edges = std::span(slot, edge_count), .layers = g_layer_infos }, 0.f);
+  g_stream_pending    = true;
+  g_stream_edge_count = static_cast<uint32_t>(edge_count);
+}
+
+void end_stream()
+{
+  // an empty stream still clears the image
+  if (!g_stream_pending)
+    stream_chunk({});
+  submit_stream_chunk(true);
+}
+
+void readback_wr_image()
+{
+  // wait for all frames, the last one left the image in general layout
+  wait_timeline(g_timeline_value);
+  collect_pending_queries();
+
+  // create host visible staging buffer
+  if (g_readback_buffer.handle)
+    destroy(g_readback_buffer);
+  g_readback_buffer = create_buffer(get_readback_size(), VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT);
+
+  // copy image to staging buffer
+  VkCommandBufferAllocateInfo cmd_info
+  {
+    .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+    .commandPool        = g_command_pool,
+    .level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+    .commandBufferCount = 1,
+  };
+  VkCommandBuffer cmd;
+  check_vk(vkAllocateCommandBuffers(g_device, &cmd_info, &cmd));
+  VkCommandBufferBeginInfo beg_info
+  {
+    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+    .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+  };
+  vkBeginCommandBuffer(cmd, &beg_info);
+  record_readback(cmd, g_wr_image, g_readback_buffer);
+  vkEndCommandBuffer(cmd);
+
+  wait_timeline(submit(cmd));
+  vkFreeCommandBuffers(g_device, g_command_pool, 1, &cmd);
+}
+
+void set_instance_edges(std::span<Edge const> edges)
+{
+  // frames in flight may read the old edges
+  wait_timeline(g_timeline_value);
+  if (g_instance_edge_buffer.handle)
+    destroy(g_instance_edge_buffer);
+  g_instance_edges.assign(edges.begin(), edges.end());
+  if (edges.empty())
+    return;
+  exit_if(edges.size_bytes() > UINT32_MAX);
+  auto size = static_cast<uint32_t>(edges.size_bytes());
+
+  // every frame reads them, so they go to device local memory through a staging buffer
+  auto staging = create_buffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+  VmaAllocationInfo info;
+  vmaGetAllocationInfo(g_allocator, staging.allocation, &info);
+  std::memcpy(info.pMappedData, edges.data(), size);
+  check_vk(vmaFlushAllocation(g_allocator, staging.allocation, 0, size));
+  g_instance_edge_buffer = create_buffer(size, VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, 0);
+
+  VkCommandBufferAllocateInfo cmd_info
+  {
+    .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+    .commandPool        = g_command_pool,
+    .level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+    .commandBufferCount = 1,
+  };
+  VkCommandBuffer cmd;
+  check_vk(vkAllocateCommandBuffers(g_device, &cmd_info, &cmd));
+  VkCommandBufferBeginInfo beg_info
+  {
+    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+    .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+  };
+  vkBeginCommandBuffer(cmd, &beg_info);
+  VkBufferCopy region
+  {
+    .size = size,
+  };
+  vkCmdCopyBuffer(cmd, staging.handle, g_instance_edge_buffer.handle, 1, &region);
+  memory_barrier(cmd);
+  vkEndCommandBuffer(cmd);
+
+  wait_timeline(submit(cmd));
+  vkFreeCommandBuffers(g_device, g_command_pool, 1, &cmd);
+  destroy(staging);
+}
+
+// host cached where there is such memory, the host reads every byte, and coherent,
+// so the thread reading it needs no invalidate
+auto create_readback_buffer(VkDeviceSize size)
+{
+  VkBufferCreateInfo buf_info
+  {
+    .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+    .size  = size,
+    .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+  };
+  VmaAllocationCreateInfo alloc_info
+  {
+    .flags          = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+    .usage          = VMA_MEMORY_USAGE_AUTO,
+    .requiredFlags  = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    .preferredFlags = VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+  };
+  Readback readback = {};
+  VmaAllocationInfo info;
+  check_vk(vmaCreateBuffer(g_allocator, &buf_info, &alloc_info, &readback.buffer.handle, &readback.buffer.allocation, &info));
+  readback.data = info.pMappedData;
+  return readback;
+}
+
+Readback create_readback()
+{
+  auto readback = create_readback_buffer(get_readback_size());
+
+  // the copy is the same every time
+  VkCommandBufferAllocateInfo cmd_info
+  {
+    .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+    .commandPool        = g_command_pool,
+    .level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+    .commandBufferCount = 1,
+  };
+  check_vk(vkAllocateCommandBuffers(g_device, &cmd_info, &readback.cmd));
+  VkCommandBufferBeginInfo beg_info
+  {
+    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+  };
+  vkBeginCommandBuffer(readback.cmd, &beg_info);
+  record_readback(readback.cmd, g_wr_image, readback.buffer);
+  vkEndCommandBuffer(readback.cmd);
+  return readback;
+}
+
+void destroy_readback(Readback& readback)
+{
+  wait_timeline(readback.timeline_value);
+  vkFreeCommandBuffers(g_device, g_command_pool, 1, &readback.cmd);
+  destroy(readback.buffer);
+  readback = {};
+}
+
+void submit_readback(Readback& readback)
+{
+  // the previous copy still runs the command buffer
+  wait_timeline(readback.timeline_value);
+  readback.timeline_value = submit(readback.cmd);
+}
+
+void wait_readback(Readback const& readback)
+{
+  wait_timeline(readback.timeline_value);
+}
+
+// worker thread of the frame readback, hands the frames to the consumer in submission order
+void consume_frames()
+{
+  auto size = get_readback_size();
+  std::unique_lock lock(g_frame_readback_mutex);
+  while (true)
+  {
+    g_frame_readback_cv.wait(lock, [] { return g_stop_frame_readback || !g_pending_frames.empty(); });
+    if (g_pending_frames.empty())
+      return;
+    auto pending = g_pending_frames.front();
+    g_pending_frames.pop_front();
+    lock.unlock();
+
+    wait_timeline(pending.timeline_value);
+    auto data = static_cast<std::byte const*>(g_frame_readbacks[pending.recording_index].data);
+    g_frame_consumer({ data, size }, pending.frame);
+
+    lock.lock();
+    g_frame_readbacks_busy[pending.recording_index] = false;
+    g_frame_readback_cv.notify_all();
+  }
+}
+
+void begin_frame_readback(FrameConsumer consumer)
+{
+  exit_if(g_windowed || g_frame_consumer);
+  g_frame_consumer = std::move(consumer);
+  for (size_t i = 0; i < g_recordings.size(); ++i)
+    g_frame_readbacks.push_back(create_readback_buffer(get_readback_size()));
+  g_frame_readbacks_busy.assign(g_recordings.size(), false);
+  g_frames_read_back    = 0;
+  g_stop_frame_readback = false;
+  g_frame_readback_thread = std::thread(consume_frames);
+
+  // recordings record again with the copy
+  ++g_scene_version;
+}
+
+void end_frame_readback()
+{
+  {
+    std::lock_guard lock(g_frame_readback_mutex);
+    g_stop_frame_readback = true;
+    g_frame_readback_cv.notify_all();
+  }
+  g_frame_readback_thread.join();
+
+  // all frames are consumed, so no submission uses the buffers anymore
+  for (auto& readback : g_frame_readbacks)
+    destroy(readback.buffer);
+  g_frame_readbacks.clear();
+  g_frame_consumer = {};
+  ++g_scene_version;
+}
+
+std::vector<float> get_readback_pixels()
+{
+  void* data;
+  check_vk(vmaMapMemory(g_allocator, g_readback_buffer.allocation, &data));
+  check_vk(vmaInvalidateAllocation(g_allocator, g_readback_buffer.allocation, 0, VK_WHOLE_SIZE));
+
+  auto pixel_count = static_cast<size_t>(g_wr_image.extent.width) * g_wr_image.extent.height;
+  std::vector<float> pixels(pixel_count * 4);
+  for (size_t i = 0; i < pixel_count; ++i)
+  {
+    auto pixel = pixels.data() + i * 4;
+    switch (g_wr_image.format)
+    {
+    case VK_FORMAT_R8_UNORM:
+      pixel[0] = pixel[1] = pixel[2] = static_cast<uint8_t const*>(data)[i] / 255.f;
+      pixel[3] = 1.f;
+      break;
+    case VK_FORMAT_R16_SFLOAT:
+      pixel[0] = pixel[1] = pixel[2] = glm::unpackHalf1x16(static_cast<uint16_t const*>(data)[i]);
+      pixel[3] = 1.f;
+      break;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+      for (uint32_t c = 0; c < 4; ++c)
+        pixel[c] = static_cast<uint8_t const*>(data)[i * 4 + c] / 255.f;
+      break;
+    default:
+      std::copy_n(static_cast<float const*>(data) + i * 4, 4, pixel);
+    }
+  }
+
+  vmaUnmapMemory(g_allocator, g_readback_buffer.allocation);
+  return pixels;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                              render context funcs
+////////////////////////////////////////////////////////////////////////////////
+
+Rasterizer::Rasterizer()
+{
+  // the device globals are shared by the contexts of the one rasterizer,
+  // they have no scene, so there are no g_wr_image and scene buffers
+  init_device(false, false);
+
+  // contexts never create pipelines, so they are thread safe once these exist
+  for (auto const& variant : g_output_variants)
+    if (supports_output_format(variant.format))
+      get_output_pipeline(variant.format);
+}
+
+std::unique_ptr<Rasterizer> Rasterizer::create()
+{
+  // a second device would overwrite the globals of the first
+  if (g_device)
+    return nullptr;
+  return std::unique_ptr<Rasterizer>(new Rasterizer());
+}
+
+Rasterizer::~Rasterizer()
+{
+  release_resources();
+  g_device = VK_NULL_HANDLE;
+}
+
+// everything a job writes, the jobs of a context run one after another on its
+// queue, so the slots only keep what the host touches while others run
+struct RenderContext::State
+{
+  VkQueue                queue;
+  std::mutex*            queue_mutex;
+  VkCommandPool          command_pool;
+  VkDescriptorPool       descriptor_pool;
+  VkDescriptorSet        descriptor_set;
+  VkPipeline             pipeline;
+  // value n means n jobs are done
+  VkSemaphore            timeline;
+  uint64_t               timeline_value;
+  Image                  image;
+  BinResources           bin;
+  UploadResources        upload;
+  std::vector<LayerInfo> layer_infos;
+  // instead of g_lod_threshold, which belongs to the thread of the g_ functions
+  float                  lod_threshold;
+  // per slot, the command buffer records the whole job and ends with the copy
+  std::vector<Readback>  readbacks;
+};
+
+RenderContext::RenderContext(Rasterizer& rasterizer, VkExtent2D extent, VkFormat format, uint32_t slot_count, float lod_threshold)
+  : m_state(std::make_unique<State>())
+{
+  auto& state = *m_state;
+  exit_if(!slot_count || lod_threshold < 0.f);
+  state.lod_threshold = lod_threshold;
+
+  // contexts share queues once there are more of them than queues, g_queue when there is no other
+  auto index = rasterizer.m_context_count++;
+  if (g_context_queues.empty())
+  {
+    state.queue       = g_queue;
+    state.queue_mutex = &g_queue_mutex;
+  }
+  else
+  {
+    auto& queue       = g_context_queues[index % g_context_queues.size()];
+    state.queue       = queue.handle;
+    state.queue_mutex = &queue.mutex;
+  }
+
+  // every job is recorded anew
+  VkCommandPoolCreateInfo command_pool_info
+  {
+    .sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+    .flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+    .queueFamilyIndex = g_context_queue_family_index,
+  };
+  check_vk(vkCreateCommandPool(g_device, &command_pool_info, nullptr, &state.command_pool));
+
+  // the image is the only descriptor
+  VkDescriptorPoolSize pool_size
+  {
+    .type            = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+    .descriptorCount = 1,
+  };
+  VkDescriptorPoolCreateInfo descriptor_pool_info
+  {
+    .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+    .maxSets       = 1,
+    .poolSizeCount = 1,
+    .pPoolSizes    = &pool_size,
+  };
+  check_vk(vkCreateDescriptorPool(g_device, &descriptor_pool_info, nullptr, &state.descriptor_pool));
+  VkDescriptorSetAllocateInfo set_info
+  {
+    .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+    .descriptorPool     = state.descriptor_pool,
+    .descriptorSetCount = 1,
+    .pSetLayouts        = &g_descriptor_set_layout,
+  };
+  check_vk(vkAllocateDescriptorSets(g_device, &set_info, &state.descriptor_set));
+
+  VkSemaphoreTypeCreateInfo type_info
+  {
+    .sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+    .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+  };
+  VkSemaphoreCreateInfo timeline_info
+  {
+    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+    .pNext = &type_info,
+  };
+  check_vk(vkCreateSemaphore(g_device, &timeline_info, nullptr, &state.timeline));
+
+  // the rasterizer created the pipelines of the formats the device can store
+  state.pipeline = get_output_variant(format).pipeline;
+  exit_if(!state.pipeline);
+  state.image = create_image(format, extent, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+  update_descriptor_set(state.descriptor_set, state.image.view);
+
+  // the buffers start empty and grow with the jobs
+  state.bin.tile_count = { (extent.width + tile_size - 1) / tile_size, (extent.height + tile_size - 1) / tile_size };
+  compute_layer_infos({}, {}, state.bin.tile_count, state.layer_infos);
+  state.bin.capacities = compute_bin_capacities({}, state.layer_infos, state.bin.tile_count);
+  create_bin_resources(state.bin);
+  create_upload_resources(state.upload, get_slot_size(0, 0, 1), slot_count);
+
+  for (uint32_t i = 0; i < slot_count; ++i)
+  {
+    auto& readback = state.readbacks.emplace_back(create_readback_buffer(get_readback_size(state.image)));
+    VkCommandBufferAllocateInfo cmd_info
+    {
+      .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+      .commandPool        = state.command_pool,
+      .level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+      .commandBufferCount = 1,
+    };
+    check_vk(vkAllocateCommandBuffers(g_device, &cmd_info, &readback.cmd));
+  }
+}
+
+RenderContext::~RenderContext()
+{
+  // the pools free their command buffers and descriptor set
+  auto& state = *m_state;
+  wait_semaphore(state.timeline, state.timeline_value);
+  for (auto& readback : state.readbacks)
+    destroy(readback.buffer);
+  release_upload_resources(state.upload);
+  release_bin_resources(state.bin);
+  destroy(state.image);
+  vkDestroySemaphore(g_device, state.timeline, nullptr);
+  vkDestroyDescriptorPool(g_device, state.descriptor_pool, nullptr);
+  vkDestroyCommandPool(g_device, state.command_pool, nullptr);
+}
+
+uint64_t RenderContext::submit(std::span<Edge const> edges, std::span<Layer const> layers)
+{
+  auto& state     = *m_state;
+  auto  slot      = static_cast<uint32_t>(state.timeline_value % state.readbacks.size());
+  auto& readback  = state.readbacks[slot];
+  auto  composite = !layers.empty();
+  exit_if(composite && get_output_variant(state.image.format).extended);
+
+  // the slot is free once its previous job is done, growing buffers waits for all jobs
+  wait_semaphore(state.timeline, readback.timeline_value);
+  compute_layer_infos(edges, layers, state.bin.tile_count, state.layer_infos);
+  auto capacities = compute_bin_capacities(edges, state.layer_infos, state.bin.tile_count);
+  auto slot_size  = get_slot_size(edges.size(), 0, state.layer_infos.size());
+  reserve_resources(state.bin, state.upload, capacities, slot_size, [&] { wait_semaphore(state.timeline, state.timeline_value); });
+  Batch batch = { .edges = edges, .layers = state.layer_infos };
+  upload_batch(state.upload, slot, batch, state.lod_threshold);
+
+  // the passes of dispatch_wr without retained coefficients, dirty tiles and profiling
+  auto cmd = readback.cmd;
+  check_vk(vkResetCommandBuffer(cmd, 0));
+  VkCommandBufferBeginInfo beg_info
+  {
+    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+    .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+  };
+  vkBeginCommandBuffer(cmd, &beg_info);
+
+  // the previous job may still read what this one clears
+  memory_barrier(cmd);
+  auto slot_address   = prepare_upload_slot(cmd, state.upload, slot, get_batch_size(batch));
+  auto push_constants = get_push_constants(state.bin, slot_address, 0, batch, 0, composite ? composite_flag : 0);
+  vkCmdPushConstants(cmd, g_wr_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants), &push_constants);
+  dispatch_bin(cmd, state.bin, batch, composite);
+  dispatch_coefficients(cmd, state.bin);
+  transform_image_layout(cmd, state.image.handle, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, g_wr_pipeline_layout, 0, 1, &state.descriptor_set, 0, nullptr);
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, state.pipeline);
+  dispatch_reconstruct(cmd, state.bin, state.image.handle, true);
+  record_readback(cmd, state.image, readback.buffer);
+  vkEndCommandBuffer(cmd);
+
+  // signal the next timeline value
+  readback.timeline_value = ++state.timeline_value;
+  VkCommandBufferSubmitInfo cmd_submit_info
+  {
+    .sType         = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+    .commandBuffer = cmd,
+  };
+  VkSemaphoreSubmitInfo signal_sem_submit_info
+  {
+    .sType     = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+    .semaphore = state.timeline,
+    .value     = readback.timeline_value,
+    .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+  };
+  VkSubmitInfo2 submit_info
+  {
+    .sType                    = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+    .commandBufferInfoCount   = 1,
+    .pCommandBufferInfos      = &cmd_submit_info,
+    .signalSemaphoreInfoCount = 1,
+    .pSignalSemaphoreInfos    = &signal_sem_submit_info,
+  };
+  std::lock_guard lock(*state.queue_mutex);
+  check_vk(vkQueueSubmit2(state.queue, 1, &submit_info, VK_NULL_HANDLE));
+  return readback.timeline_value;
+}
+
+std::span<std::byte const> RenderContext::wait(uint64_t job)
+{
+  // the slot of a job is reused slot_count jobs later
+  auto& state = *m_state;
+  exit_if(!job || job > state.timeline_value || job + state.readbacks.size() <= state.timeline_value);
+  auto const& readback = state.readbacks[(job - 1) % state.readbacks.size()];
+  wait_semaphore(state.timeline, job);
+  return { static_cast<std::byte const*>(readback.data), get_readback_size(state.image) };
+}
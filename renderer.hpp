@@ -0,0 +1,372 @@
+#pragma once
+
+#include <vk_mem_alloc.h>
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdlib>
+#include <array>
+#include <fstream>
+#include <string_view>
+#include <charconv>
+#include <span>
+#include <functional>
+#include <atomic>
+#include <memory>
+
+//
+// wavelet rasterization engine shared by the viewer and the benchmark,
+// state lives in the g_ globals of renderer.cpp, the g_ functions are for
+// a single thread, services rasterizing on several threads use a
+// RenderContext per thread, see the end of this file
+//
+
+////////////////////////////////////////////////////////////////////////////////
+//                              types
+////////////////////////////////////////////////////////////////////////////////
+
+// frame slots bound how far the cpu runs ahead of the gpu
+struct Frame
+{
+  VkSemaphore image_available;
+};
+
+// command buffer recorded once per swapchain image, or per frame slot when headless,
+// and again after the scene changed, retained scenes record it every frame
+struct Recording
+{
+  VkCommandBuffer cmd;
+  VkSemaphore     render_finished;
+  uint64_t        timeline_value;
+  uint64_t        scene_version;
+  bool            queries_pending;
+  // ends with a copy of g_wr_image for begin_frame_readback
+  bool            readback;
+};
+
+struct Image
+{
+  VkImage       handle;
+  VkImageView   view;
+  VmaAllocation allocation;
+  VkFormat      format;
+  VkExtent3D    extent;
+};
+
+struct Buffer
+{
+  VkBuffer      handle;
+  VmaAllocation allocation;
+};
+
+// persistently mapped and coherent copy of g_wr_image, its command buffer is recorded
+// for the image it was created for, a few of them let the gpu go on with the next
+// frames while the host reads one
+struct Readback
+{
+  Buffer          buffer;
+  void const*     data;
+  VkCommandBuffer cmd;
+  uint64_t        timeline_value;
+};
+
+enum class EdgeType : uint32_t
+{
+  line,
+  quadratic,
+  cubic,
+};
+
+// matches Edge in shader.glsl, points are in pixel coordinates
+// lines use p0 and p1, quadratics p0 to p2 and cubics all four points,
+// coarse_levels is set on upload, see g_lod_threshold
+struct Edge
+{
+  glm::vec2 p0;
+  glm::vec2 p1;
+  glm::vec2 p2;
+  glm::vec2 p3;
+  EdgeType  type;
+  uint32_t  coarse_levels;
+};
+static_assert(sizeof(Edge) == 40, "std430 layout of Edge");
+
+enum class PaintType : uint32_t
+{
+  solid,
+  linear,
+  radial,
+};
+
+// colors are straight rgba, solid paints only use color0, gradients go from color0
+// at p0 to color1 at p1, linear ones along the line, radial ones out from p0
+struct Paint
+{
+  PaintType type;
+  glm::vec4 color0;
+  glm::vec4 color1;
+  glm::vec2 p0;
+  glm::vec2 p1;
+};
+
+// the edges of g_edges from first_edge up to the first edge of the next layer,
+// filled with paint
+struct Layer
+{
+  uint32_t first_edge;
+  Paint    paint;
+};
+
+// edge_count edges of set_instance_edges from first_edge on, moved to origin
+struct Instance
+{
+  glm::vec2 origin;
+  uint32_t  first_edge;
+  uint32_t  edge_count;
+};
+
+// affine map of path coordinates to pixels, p' = linear * p + offset, the svg
+// matrix(a, b, c, d, e, f) has the columns { a, b } and { c, d } and offset { e, f }
+struct Transform
+{
+  glm::mat2 linear = glm::mat2(1.f);
+  glm::vec2 offset = glm::vec2(0.f);
+};
+
+// tiles are quadtrees of tile_levels levels over tile_size x tile_size pixels
+constexpr uint32_t tile_size   = 16;
+constexpr int      tile_levels = 4;
+// coefficients of one tile quadtree, see common.glsl
+constexpr uint32_t block_size  = 256;
+
+enum Pass : uint32_t
+{
+  pass_bin,
+  pass_coefficients,
+  pass_reconstruct,
+  pass_blit,
+  pass_count,
+};
+
+constexpr char const* pass_names[pass_count] = { "bin", "coefficients", "reconstruct", "blit" };
+
+struct PassStats
+{
+  double min;
+  double avg;
+  double p99;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//                              global vars
+////////////////////////////////////////////////////////////////////////////////
+
+extern VkPhysicalDevice   g_physical_device;
+extern VkQueue            g_queue;
+extern VkDevice           g_device;
+extern VmaAllocator       g_allocator;
+extern Image              g_wr_image;
+extern std::vector<Edge>  g_edges;
+extern uint32_t           g_frames_in_flight;
+extern bool               g_headless;
+extern VkExtent2D         g_headless_extent;
+// set by init_vk from g_headless, a Rasterizer leaves it false
+extern bool               g_windowed;
+extern VkFormat           g_output_format;
+// the scene is kept in the paths of retained_scene.hpp, set before init_vk
+extern bool               g_retained;
+// closed contours smaller than this many pixels skip the finest quadtree levels,
+// one more for every halving of their size, 0 keeps all levels, set before init_vk
+extern float              g_lod_threshold;
+// composited back to front over opaque black in one pass, rgba images only,
+// without layers g_wr_image holds the coverage of all edges
+extern std::vector<Layer> g_layers;
+extern Buffer             g_readback_buffer;
+extern std::ofstream      g_profile_csv;
+// while there are any, frames rasterize these instead of g_edges, not retained
+// and without layers, update_scene after changing them
+extern std::vector<Instance> g_instances;
+
+////////////////////////////////////////////////////////////////////////////////
+//                              funcs
+////////////////////////////////////////////////////////////////////////////////
+
+inline void exit_if(bool b)
+{
+  if (b) exit(1);
+}
+
+inline void check_vk(VkResult result)
+{
+  exit_if(result != VK_SUCCESS);
+}
+
+inline glm::vec2 get_end(Edge const& edge)
+{
+  switch (edge.type)
+  {
+  case EdgeType::line:      return edge.p1;
+  case EdgeType::quadratic: return edge.p2;
+  default:                  return edge.p3;
+  }
+}
+
+// command line values, exit on malformed input
+inline auto parse_uint(std::string_view str)
+{
+  uint32_t value = 0;
+  auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+  exit_if(ec != std::errc() || ptr != str.data() + str.size());
+  return value;
+}
+
+// <width>x<height>
+inline auto parse_extent(std::string_view str)
+{
+  auto pos = str.find('x');
+  exit_if(pos == std::string_view::npos);
+  VkExtent2D extent = { parse_uint(str.substr(0, pos)), parse_uint(str.substr(pos + 1)) };
+  exit_if(!extent.width || !extent.height);
+  return extent;
+}
+
+// r8, r16f, rgba8 or rgba32f, coverage masks need a single channel
+inline VkFormat parse_format(std::string_view str)
+{
+  if (str == "r8")      return VK_FORMAT_R8_UNORM;
+  if (str == "r16f")    return VK_FORMAT_R16_SFLOAT;
+  if (str == "rgba8")   return VK_FORMAT_R8G8B8A8_UNORM;
+  if (str == "rgba32f") return VK_FORMAT_R32G32B32A32_SFLOAT;
+  exit(1);
+}
+
+void write_ppm(std::string_view filename, float const* pixels, VkExtent2D extent);
+
+// init and shutdown, init_SDL is only needed for the window
+void init_SDL();
+// without scene there is no demo scene and no g_wr_image until create_scene_resources
+void init_vk(bool scene = true);
+void release_resources();
+
+// scene building, edges are collected in g_edges until create_scene_resources uploads them
+void add_line(glm::vec2 p0, glm::vec2 p1);
+void add_polygon(std::vector<glm::vec2> const& points);
+template <size_t N>
+void add_bezier(std::array<glm::vec2, N> points);
+// the x and y monotone pieces of an edge in order, as add_bezier splits them, returns their count
+constexpr size_t max_monotone_pieces = 5;
+size_t get_monotone_pieces(Edge const& edge, std::array<Edge, max_monotone_pieces>& pieces);
+void add_circle(glm::vec2 center, float radius, bool clockwise = false);
+void add_arc(glm::vec2 p0, glm::vec2 radius, float rotation, bool large_arc, bool sweep, glm::vec2 p1);
+std::vector<glm::vec2> regular_polygon(glm::vec2 center, float outer_radius, float inner_radius, uint32_t count, bool clockwise = false);
+void create_demo_scene(VkExtent2D extent);
+// the edges added afterwards form a new layer on top of the others
+void add_layer(Paint const& paint);
+// count overlapping translucent stars and rings with solid and gradient paints
+void create_layer_demo_scene(VkExtent2D extent, uint32_t count);
+void create_scene_resources(VkExtent2D extent, VkFormat format = g_output_format);
+// upload g_edges again after changing them, the target keeps its extent and format
+void update_scene();
+void release_scene_resources();
+// copies edges into device local memory once, g_instances place ranges of them,
+// waits for the frames in flight, the edges outlive the scene resources
+void set_instance_edges(std::span<Edge const> edges);
+
+// profiling
+void collect_pending_queries();
+void reset_pass_stats();
+PassStats get_pass_stats(Pass pass);
+void print_pass_stats();
+
+// rendering
+void render();
+void render_headless();
+// rasterize a scene chunk by chunk, so it is never whole in host memory, headless
+// retained scenes only, the chunks accumulate into the retained coefficients and
+// replace the paths until the next rebuild, end_stream reconstructs g_wr_image
+void begin_stream();
+void stream_chunk(std::span<Edge const> edges);
+// the edges are transformed and culled on all cores while they are written into
+// the upload slot, see preprocess.hpp, they keep all levels whatever g_lod_threshold is
+void stream_chunk(std::span<Edge const> edges, Transform const& transform);
+void end_stream();
+void readback_wr_image();
+Readback create_readback();
+void destroy_readback(Readback& readback);
+// copy g_wr_image after the frames submitted so far, without waiting for them
+void submit_readback(Readback& readback);
+// wait for the copy, data holds it until the readback is submitted again
+void wait_readback(Readback const& readback);
+
+// the pixels of a frame in the format of g_wr_image, valid during the call,
+// frame counts the frames read back since begin_frame_readback
+using FrameConsumer = std::function<void(std::span<std::byte const> pixels, uint64_t frame)>;
+// headless only, every frame slot ends its submission with a copy of g_wr_image into
+// its own host cached buffer and a worker thread calls consumer with it once the
+// timeline reaches the frame, so rendering, copies and consumer overlap, a slot is
+// only reused after consumer returned, g_wr_image keeps its extent meanwhile
+void begin_frame_readback(FrameConsumer consumer);
+// returns once consumer saw every frame submitted before
+void end_frame_readback();
+// g_readback_buffer as RGBA32F, single channel coverage is spread over rgb
+std::vector<float> get_readback_pixels();
+
+////////////////////////////////////////////////////////////////////////////////
+//                              render contexts
+////////////////////////////////////////////////////////////////////////////////
+
+// init_vk without window and scene in create and release_resources in the
+// destructor, g_headless is left alone, the device, the pipelines and the
+// pipeline cache are only written by these, so render contexts share them from
+// any thread, the g_ functions keep working headless on the thread which created
+// it after create_scene_resources
+class Rasterizer
+{
+public:
+  // one per process, nullptr while a rasterizer or init_vk holds the device, the
+  // pipelines of every output format the device can store are created up front
+  static std::unique_ptr<Rasterizer> create();
+  ~Rasterizer();
+
+  Rasterizer(Rasterizer const&)            = delete;
+  Rasterizer& operator=(Rasterizer const&) = delete;
+
+private:
+  friend class RenderContext;
+
+  Rasterizer();
+
+  // contexts take the queues of renderer.cpp in turn
+  std::atomic<uint32_t> m_context_count = 0;
+};
+
+// rasterizes jobs into an image of its own, a context is used by one thread at a
+// time, contexts own their command pool, descriptor set, upload ring, bin buffers,
+// readbacks and timeline, so their threads record and submit at the same time, on
+// queues of their own where the device has several, destroyed before the rasterizer
+class RenderContext
+{
+public:
+  // up to slot_count jobs are in flight, format is one of parse_format the device can store,
+  // lod_threshold is g_lod_threshold of the jobs, contexts never read the g_ settings
+  RenderContext(Rasterizer& rasterizer, VkExtent2D extent, VkFormat format = VK_FORMAT_R32G32B32A32_SFLOAT, uint32_t slot_count = 2, float lod_threshold = 0.f);
+  ~RenderContext();
+
+  RenderContext(RenderContext const&)            = delete;
+  RenderContext& operator=(RenderContext const&) = delete;
+
+  // upload, record and submit a job without waiting for the gpu, unless the job
+  // slot_count jobs before is still running, layers are composited as g_layers
+  // are, rgba formats only, returns the job for wait
+  uint64_t submit(std::span<Edge const> edges, std::span<Layer const> layers = {});
+  // the pixels of a job in the format of the context, valid until slot_count more
+  // jobs were submitted
+  std::span<std::byte const> wait(uint64_t job);
+
+private:
+  struct State;
+  std::unique_ptr<State> m_state;
+};
@@ -0,0 +1,115 @@
+#include "retained_scene.hpp"
+
+#include <unordered_map>
+#include <limits>
+#include <utility>
+
+////////////////////////////////////////////////////////////////////////////////
+//                              global vars
+////////////////////////////////////////////////////////////////////////////////
+
+struct Path
+{
+  std::vector<Edge> edges;
+  uint64_t          hash;
+  glm::vec4         bounds;
+};
+
+std::unordered_map<uint32_t, Path> g_paths;
+SceneDelta                         g_scene_delta;
+
+////////////////////////////////////////////////////////////////////////////////
+//                              funcs
+////////////////////////////////////////////////////////////////////////////////
+
+// fnv-1a over the edges, coarse_levels is only set on upload and zero here
+uint64_t hash_edges(std::span<Edge const> edges)
+{
+  uint64_t hash = 0xcbf29ce484222325;
+  for (auto byte : std::as_bytes(edges))
+    hash = (hash ^ static_cast<uint8_t>(byte)) * 0x100000001b3;
+  return hash;
+}
+
+// min and max of the control points, curves stay inside them
+glm::vec4 get_bounds(std::span<Edge const> edges)
+{
+  auto min = glm::vec2(std::numeric_limits<float>::max());
+  auto max = glm::vec2(std::numeric_limits<float>::lowest());
+  for (auto const& edge : edges)
+  {
+    glm::vec2 points[] = { edge.p0, edge.p1, edge.p2, edge.p3 };
+    auto point_count   = edge.type == EdgeType::line ? 2 : edge.type == EdgeType::quadratic ? 3 : 4;
+    for (int i = 0; i < point_count; ++i)
+    {
+      min = glm::min(min, points[i]);
+      max = glm::max(max, points[i]);
+    }
+  }
+  return glm::vec4(min, max);
+}
+
+// coefficients are linear in the edges, the reversed edge adds the negated ones
+Edge reverse(Edge const& edge)
+{
+  switch (edge.type)
+  {
+  case EdgeType::line:      return { .p0 = edge.p1, .p1 = edge.p0, .type = edge.type };
+  case EdgeType::quadratic: return { .p0 = edge.p2, .p1 = edge.p1, .p2 = edge.p0, .type = edge.type };
+  default:                  return { .p0 = edge.p3, .p1 = edge.p2, .p2 = edge.p1, .p3 = edge.p0, .type = edge.type };
+  }
+}
+
+// in reverse order, so the reversed contours stay chained and get the coarse levels they were added with
+void subtract_path(Path const& path)
+{
+  for (auto it = path.edges.rbegin(); it != path.edges.rend(); ++it)
+    g_scene_delta.edges.push_back(reverse(*it));
+  g_scene_delta.bounds.push_back(path.bounds);
+}
+
+void set_path(uint32_t id, std::span<Edge const> edges)
+{
+  auto hash = hash_edges(edges);
+  auto it   = g_paths.find(id);
+  if (it != g_paths.end())
+  {
+    if (it->second.hash == hash)
+      return;
+    subtract_path(it->second);
+  }
+
+  auto& path  = g_paths[id];
+  path.edges.assign(edges.begin(), edges.end());
+  path.hash   = hash;
+  path.bounds = get_bounds(edges);
+  g_scene_delta.edges.insert(g_scene_delta.edges.end(), edges.begin(), edges.end());
+  g_scene_delta.bounds.push_back(path.bounds);
+}
+
+void remove_path(uint32_t id)
+{
+  auto it = g_paths.find(id);
+  if (it == g_paths.end())
+    return;
+  subtract_path(it->second);
+  g_paths.erase(it);
+}
+
+void clear_paths()
+{
+  g_paths.clear();
+  g_scene_delta = { .rebuild = true };
+}
+
+void gather_path_edges()
+{
+  g_edges.clear();
+  for (auto const& [id, path] : g_paths)
+    g_edges.insert(g_edges.end(), path.edges.begin(), path.edges.end());
+}
+
+SceneDelta take_scene_delta()
+{
+  return std::exchange(g_scene_delta, {});
+}
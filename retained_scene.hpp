@@ -0,0 +1,50 @@
+#pragma once
+
+#include "renderer.hpp"
+
+#include <span>
+
+//
+// retained scene for g_retained, every path keeps what it added to the
+// coefficients of the tiles across frames, so a frame only rasterizes the
+// paths added, removed or changed since the last one
+//
+// the coefficients are a single accumulator per tile shared by all paths, not
+// a cache per path: a removed path is subtracted by adding its edges reversed,
+// which cancels what it added only up to rounding
+//
+// tile backdrops are fixed point ints, see BACKDROP_SCALE in common.glsl, an
+// edge and its reverse add exactly opposite values, so they never drift
+//
+// the coefficient blocks are float atomics, every contribution rounds once by
+// at most half an ulp of the running sum, so after n contributions to a
+// coefficient of magnitude up to m it is off by at most n * m * 2^-24, m being
+// the largest winding number over the tile, a pixel sums at most one
+// coefficient per level, each bounded the same way
+//
+// the renderer rebuilds from all paths every rebuild_interval (256) frames
+// which changed the scene, on the first frame and when more than half the
+// tiles are dirty, which resets the drift, ctest runs gpu_validate_edits over
+// 4 rebuild intervals of random edits, ending on the last frame before a
+// rebuild, against rasterize_cpu
+//
+
+// edges and pixel bounds changed since the last frame, removed paths come
+// back with reversed edges and subtract what they added before
+struct SceneDelta
+{
+  std::vector<Edge>      edges;
+  std::vector<glm::vec4> bounds;
+  bool                   rebuild;
+};
+
+// add or replace path id, a path with the geometry hash it has already changes nothing
+void set_path(uint32_t id, std::span<Edge const> edges);
+void remove_path(uint32_t id);
+void clear_paths();
+
+// edges of all paths into g_edges, rebuilds rasterize the whole scene from there
+void gather_path_edges();
+
+// changes since the last call
+SceneDelta take_scene_delta();
@@ -0,0 +1,133 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_buffer_reference : require
+
+//
+// Runs as a single workgroup between the binning passes of bin.glsl.
+// Turns the per tile edge counts into offsets with an exclusive prefix
+// sum, hands out coefficient blocks to the tiles with edges, and turns
+// the backdrop deltas into suffix sums along every tile row of every
+// layer. Retained scenes own a block per tile and add the suffix sums to
+// the tile backdrops of the previous frame when accumulating. When
+// compositing, it counts the layers which are not empty in each tile of
+// the image for compose.glsl.
+//
+// It also writes the indirect dispatch arguments of the passes after the
+// binning, so the host records the same dispatches whatever the scene
+// holds: one invocation of coefficients.glsl per tile list entry, and one
+// workgroup of shader.glsl per tile of the image inside the bounds of the
+// tiles with edges or a backdrop. The tiles outside have a coverage of 0
+// and are cleared. Retained tiles keep coefficients of earlier frames, so
+// all of them are reconstructed.
+//
+
+#include "common.glsl"
+
+#define GROUP_SIZE 256
+
+layout(local_size_x = GROUP_SIZE) in;
+
+// edge count and tiles with edges
+shared uvec2 sums[GROUP_SIZE];
+// min x, min y, max x and max y of the tiles which are not empty
+shared int bounds[4];
+
+void main()
+{
+  uvec2 totals     = get_layer_totals();
+  uint  tile_total = totals.x;
+  bool  retained   = (flags & FLAG_RETAINED) != 0;
+  bool  accumulate = (flags & FLAG_ACCUMULATE) != 0;
+  bool  composite  = (flags & FLAG_COMPOSITE) != 0;
+
+  // every invocation sums a contiguous chunk of tiles
+  uint id    = gl_LocalInvocationIndex;
+  uint chunk = (tile_total + GROUP_SIZE - 1) / GROUP_SIZE;
+  uint beg   = min(id * chunk, tile_total);
+  uint end   = min(beg + chunk, tile_total);
+  uvec2 sum   = uvec2(0);
+  for (uint i = beg; i < end; ++i)
+  {
+    uint count = tile_buffer.tiles[i].count;
+    sum += uvec2(count, count > 0 ? 1 : 0);
+  }
+
+  // inclusive scan of the chunk sums
+  sums[id] = sum;
+  if (id < 4)
+    bounds[id] = id < 2 ? tile_count[id] : -1;
+  barrier();
+  for (uint offset = 1; offset < GROUP_SIZE; offset <<= 1)
+  {
+    uvec2 value = id >= offset ? sums[id - offset] : uvec2(0);
+    barrier();
+    sums[id] += value;
+    barrier();
+  }
+
+  // write exclusive offsets, the cursor is advanced by the scatter pass
+  uvec2 offset = sums[id] - sum;
+  for (uint i = beg; i < end; ++i)
+  {
+    uint count = tile_buffer.tiles[i].count;
+    tile_buffer.tiles[i].offset = offset.x;
+    tile_buffer.tiles[i].cursor = offset.x;
+    tile_buffer.tiles[i].block  = retained ? i : count > 0 && offset.y < block_capacity ? offset.y : NO_BLOCK;
+    offset += uvec2(count, count > 0 ? 1 : 0);
+  }
+
+  // backdrop of a tile is the sum of the deltas right of it in its layer
+  ivec2 local_min = tile_count;
+  ivec2 local_max = ivec2(-1);
+  for (uint row = id; row < totals.y; row += GROUP_SIZE)
+  {
+    Layer layer    = layer_buffer.layers[find_layer(LAYER_ROW, row)];
+    int   y        = int(row - layer.first_row);
+    int   backdrop = 0;
+    for (int x = layer.tile_extent.x; x >= 0; --x)
+    {
+      // fixed point, so retained tile backdrops add and subtract paths exactly
+      uint i     = get_backdrop_index(layer, ivec2(x, y));
+      int  delta = backdrop_buffer.backdrops[i];
+      backdrop_buffer.backdrops[i] = backdrop;
+      if (retained)
+        tile_backdrop_buffer.backdrops[i] = (accumulate ? tile_backdrop_buffer.backdrops[i] : 0) + backdrop;
+
+      // the tile is empty without edges and backdrop
+      if (x < layer.tile_extent.x && (backdrop != 0 || tile_buffer.tiles[get_layer_tile(layer, ivec2(x, y))].count > 0))
+      {
+        ivec2 tile = layer.tile_min + ivec2(x, y);
+        local_min  = min(local_min, tile);
+        local_max  = max(local_max, tile);
+        if (composite)
+          atomicAdd(tile_layer_buffer.tile_layers[tile.y * tile_count.x + tile.x].count, 1u);
+      }
+      backdrop += delta;
+    }
+  }
+  atomicMin(bounds[0], local_min.x);
+  atomicMin(bounds[1], local_min.y);
+  atomicMax(bounds[2], local_max.x);
+  atomicMax(bounds[3], local_max.y);
+  barrier();
+
+  if (id == 0)
+  {
+    // entries past the capacity were dropped by the scatter pass
+    uint tile_edge_count = min(sums[GROUP_SIZE - 1].x, tile_edge_capacity);
+    counter_buffer.counters.tile_edge_count       = tile_edge_count;
+    counter_buffer.counters.block_count           = min(sums[GROUP_SIZE - 1].y, block_capacity);
+    counter_buffer.counters.coefficient_groups[0] = (tile_edge_count + 255) / 256;
+    counter_buffer.counters.coefficient_groups[1] = 1;
+    counter_buffer.counters.coefficient_groups[2] = 1;
+
+    ivec2 lo     = ivec2(bounds[0], bounds[1]);
+    ivec2 hi     = ivec2(bounds[2], bounds[3]);
+    ivec2 origin = retained ? ivec2(0) : min(lo, tile_count);
+    ivec2 groups = retained ? tile_count : max(hi - lo + 1, ivec2(0));
+    counter_buffer.counters.reconstruct_origin    = origin;
+    counter_buffer.counters.reconstruct_groups[0] = uint(groups.x);
+    counter_buffer.counters.reconstruct_groups[1] = uint(groups.y);
+    counter_buffer.counters.reconstruct_groups[2] = 1;
+  }
+}
@@ -0,0 +1,121 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+
+std::unique_ptr<Scheduler> g_scheduler;
+
+Scheduler& get_scheduler()
+{
+  if (!g_scheduler)
+    g_scheduler = std::make_unique<Scheduler>();
+  return *g_scheduler;
+}
+
+Scheduler::Scheduler(uint32_t thread_count)
+{
+  // thread 0 is the caller of parallel_for
+  thread_count = std::max(thread_count, 1u);
+  for (uint32_t i = 0; i < thread_count; ++i)
+    m_queues.push_back(std::make_unique<Queue>());
+  for (uint32_t i = 1; i < thread_count; ++i)
+    m_threads.emplace_back(&Scheduler::worker_loop, this, i);
+}
+
+Scheduler::~Scheduler()
+{
+  {
+    std::lock_guard lock(m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_all();
+  for (auto& thread : m_threads)
+    thread.join();
+}
+
+void Scheduler::parallel_for(uint32_t count, std::function<void(uint32_t)> const& task)
+{
+  if (!count)
+    return;
+
+  // the task and counter are set before any index becomes visible,
+  // so a late worker of the previous call runs the right task
+  m_task = &task;
+  m_remaining.store(count);
+
+  // contiguous ranges keep neighbouring tasks on one thread until stolen
+  auto thread_count = this->thread_count();
+  for (uint32_t thread = 0; thread < thread_count; ++thread)
+  {
+    auto beg = static_cast<uint64_t>(count) * thread / thread_count;
+    auto end = static_cast<uint64_t>(count) * (thread + 1) / thread_count;
+    std::lock_guard lock(m_queues[thread]->mutex);
+    for (auto i = beg; i < end; ++i)
+      m_queues[thread]->indices.push_back(static_cast<uint32_t>(i));
+  }
+
+  {
+    std::lock_guard lock(m_mutex);
+    ++m_generation;
+  }
+  m_wake.notify_all();
+
+  work(0);
+  for (auto remaining = m_remaining.load(); remaining; remaining = m_remaining.load())
+    m_remaining.wait(remaining);
+}
+
+bool Scheduler::pop(uint32_t thread, uint32_t& index)
+{
+  // own queue from the back
+  {
+    auto& queue = *m_queues[thread];
+    std::lock_guard lock(queue.mutex);
+    if (!queue.indices.empty())
+    {
+      index = queue.indices.back();
+      queue.indices.pop_back();
+      return true;
+    }
+  }
+
+  // steal from the front of the others
+  for (uint32_t i = 1; i < thread_count(); ++i)
+  {
+    auto& queue = *m_queues[(thread + i) % thread_count()];
+    std::lock_guard lock(queue.mutex);
+    if (!queue.indices.empty())
+    {
+      index = queue.indices.front();
+      queue.indices.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void Scheduler::work(uint32_t thread)
+{
+  uint32_t index;
+  while (pop(thread, index))
+  {
+    (*m_task)(index);
+    if (m_remaining.fetch_sub(1) == 1)
+      m_remaining.notify_all();
+  }
+}
+
+void Scheduler::worker_loop(uint32_t thread)
+{
+  uint64_t generation = 0;
+  while (true)
+  {
+    {
+      std::unique_lock lock(m_mutex);
+      m_wake.wait(lock, [&] { return m_stop || m_generation != generation; });
+      if (m_stop)
+        return;
+      generation = m_generation;
+    }
+    work(thread);
+  }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+
+//
+// work stealing scheduler, every thread owns a queue of task indices,
+// takes work from its back and steals from the front of the others
+//
+class Scheduler
+{
+public:
+  explicit Scheduler(uint32_t thread_count = std::thread::hardware_concurrency());
+  ~Scheduler();
+
+  Scheduler(Scheduler const&)            = delete;
+  Scheduler& operator=(Scheduler const&) = delete;
+
+  // calls task(i) for every i in [0, count) on all threads including the
+  // caller, returns once all calls are done
+  void parallel_for(uint32_t count, std::function<void(uint32_t)> const& task);
+
+  auto thread_count() const { return static_cast<uint32_t>(m_queues.size()); }
+
+private:
+  struct Queue
+  {
+    std::mutex           mutex;
+    std::deque<uint32_t> indices;
+  };
+
+  bool pop(uint32_t thread, uint32_t& index);
+  void work(uint32_t thread);
+  void worker_loop(uint32_t thread);
+
+  std::vector<std::unique_ptr<Queue>>  m_queues;
+  std::vector<std::thread>             m_threads;
+  std::function<void(uint32_t)> const* m_task = nullptr;
+  std::atomic<uint32_t>                m_remaining;
+  std::mutex                           m_mutex;
+  std::condition_variable              m_wake;
+  uint64_t                             m_generation = 0;
+  bool                                 m_stop       = false;
+};
+
+// process wide scheduler over all cores, created on first use, the cpu
+// rasterizer and the path preprocessing share it from one thread at a time
+Scheduler& get_scheduler();
@@ -1,15 +1,217 @@
 #version 460
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_buffer_reference : require
 
+//
+// Wavelet rasterization of closed polygons,
+// see Manson and Schaefer, "Wavelet Rasterization".
+//
+// Every workgroup reconstructs one 16x16 tile, which is a cell of the
+// wavelet quadtree, from the coefficient block coefficients.glsl wrote.
+// The inverse Haar transform runs top-down in shared memory: at each
+// level every child cell gets
+//
+//   c + sx * dx + sy * dy + sx * sy * dxy
+//
+// of its parent, where sx/sy are +1 for the left/top half of the parent
+// and -1 otherwise, until the children are the pixels. The coarser levels
+// above the tile telescope into its scaling coefficient, the backdrop of
+// the edges right of the tile (see bin.glsl) plus the edges in the tile.
+// Tiles without edges have a constant coverage of their backdrop.
+//
+// Layered scenes composite in the same pass: the workgroup sorts the list
+// compose.glsl built for its tile, reconstructs the coverage of each layer
+// in turn and blends its paint over the color each invocation keeps for
+// its pixel, so every pixel is stored once whatever the layer count.
+//
+// The descent stops per node: a node whose detail coefficients and those
+// of all nodes below it are float residues of edges which cancel, is
+// uniformly covered or empty, or its edges skipped the finer levels (see
+// coarse_levels in common.glsl), and all its pixels take its value. The
+// loop itself ends below the deepest node which is not.
+//
+// The workgroups run over the bounds of the tiles which are not empty, see
+// scan.glsl, the image is cleared before. When only part of a retained
+// scene changed, they run over the dirty tile list instead and the other
+// tiles keep the pixels of the previous frame.
+//
+// The image is either g_wr_image or, when the surface allows it, the
+// swapchain image itself. srgb is set if that is the unorm twin of an srgb
+// format, image stores never encode. OUTPUT_FORMAT is the format qualifier
+// of g_wr_image, single channel formats only keep the coverage in red.
+//
+
+#include "common.glsl"
+
+layout(constant_id = 0) const bool srgb = false;
+
+#ifdef OUTPUT_FORMAT
+layout(binding = 0, OUTPUT_FORMAT) uniform writeonly image2D image;
+#else
 layout(binding = 0) uniform writeonly image2D image;
+#endif
+
+layout(local_size_x = TILE_SIZE, local_size_y = TILE_SIZE) in;
+
+// a coefficient below this is a residue, a pixel sums the details of one node
+// per level, so dropping them changes it by less than 3 * TILE_LEVELS of it
+#define COEFFICIENT_EPSILON 1e-4
+// the nodes of the levels of a block, their details start at 3 * node + 1
+#define NODE_COUNT ((BLOCK_SIZE - 1) / 3)
+
+shared float coefficients[BLOCK_SIZE];
+shared float values[2][TILE_SIZE * TILE_SIZE];
+shared int   depth;
+// bit n is set if node n or a node below it has a detail above the epsilon
+shared uint  active_nodes[(NODE_COUNT + 31) / 32];
+
+uint node_index(int level, ivec2 cell)
+{
+  return ((1u << (2 * level)) - 1u) / 3u + uint(cell.y * (1 << level) + cell.x);
+}
+
+// coverage of the pixel of the invocation in a tile with the coefficients
+// of block on top of backdrop, the whole workgroup calls it for the same tile
+float get_coverage(uint block, float backdrop)
+{
+  if (block == NO_BLOCK)
+    return clamp(abs(backdrop), 0.0, 1.0);
+
+  uint id = gl_LocalInvocationIndex;
+  if (id == 0)
+    depth = 0;
+  if (id < active_nodes.length())
+    active_nodes[id] = 0;
+  barrier();
+
+  // the details of level l start at 4^l, a detail above the epsilon keeps its
+  // node and the nodes above it active
+  coefficients[id] = block_buffer.blocks[block * BLOCK_SIZE + id];
+  if (id > 0 && abs(coefficients[id]) >= COEFFICIENT_EPSILON)
+  {
+    int   level = findMSB(id) / 2;
+    uint  local = (id - 1) / 3 - node_index(level, ivec2(0));
+    ivec2 cell  = ivec2(local % (1u << level), local / (1u << level));
+    atomicMax(depth, level + 1);
+    for (; level >= 0; --level, cell /= 2)
+    {
+      uint node = node_index(level, cell);
+      atomicOr(active_nodes[node / 32], 1u << (node % 32));
+    }
+  }
+  if (id == 0)
+    values[0][0] = backdrop + coefficients[0];
+  barrier();
+
+  // level l has 2^l x 2^l cells, every invocation below 4^(l+1) computes one child
+  for (int level = 0; level < depth; ++level)
+  {
+    int cells = 1 << level;
+    if (id < 4 * cells * cells)
+    {
+      ivec2 child  = ivec2(id % (2 * cells), id / (2 * cells));
+      ivec2 parent = child / 2;
+      uint  node   = node_index(level, parent);
+      float value  = values[level % 2][parent.y * cells + parent.x];
+      // the cells below an inactive node keep its value
+      if ((active_nodes[node / 32] & (1u << (node % 32))) != 0)
+      {
+        uint  i  = coefficient_index(level, parent);
+        float sx = child.x % 2 == 0 ? 1.0 : -1.0;
+        float sy = child.y % 2 == 0 ? 1.0 : -1.0;
+        value += sx * coefficients[i] + sy * coefficients[i + 1] + sx * sy * coefficients[i + 2];
+      }
+      values[(level + 1) % 2][id] = value;
+    }
+    barrier();
+  }
+  ivec2 cell     = ivec2(gl_LocalInvocationID.xy) >> (TILE_LEVELS - depth);
+  float coverage = values[depth % 2][cell.y * (1 << depth) + cell.x];
+
+  // the next tile overwrites the shared arrays
+  barrier();
+  return clamp(abs(coverage), 0.0, 1.0);
+}
 
-layout(local_size_x = 16, local_size_y = 16) in;
+// bitonic sort of the layer list of a tile in place, every pair puts the smaller
+// tile first, so the missing entries up to a power of two act as the largest
+void sort_layers(uint offset, uint count)
+{
+  uint size = count > 1 ? 2u << findMSB(count - 1) : 1;
+  for (uint k = 2; k <= size; k <<= 1)
+    for (uint j = k >> 1; j > 0; j >>= 1)
+    {
+      // the first step of a merge compares mirrored entries
+      for (uint i = gl_LocalInvocationIndex; i < size / 2; i += TILE_SIZE * TILE_SIZE)
+      {
+        uint lo = 2 * j * (i / j) + i % j;
+        uint hi = j == k >> 1 ? lo ^ (k - 1) : lo + j;
+        if (hi >= count)
+          continue;
+        uint a = layer_list_buffer.layer_list[offset + lo];
+        uint b = layer_list_buffer.layer_list[offset + hi];
+        if (a > b)
+        {
+          layer_list_buffer.layer_list[offset + lo] = b;
+          layer_list_buffer.layer_list[offset + hi] = a;
+        }
+      }
+      memoryBarrierBuffer();
+      barrier();
+    }
+}
+
+// straight rgba of the paint of a layer at p
+vec4 get_paint(Layer layer, vec2 p)
+{
+  if (layer.paint_type == PAINT_SOLID)
+    return layer.color0;
+  vec2  d = layer.p1 - layer.p0;
+  float t = layer.paint_type == PAINT_LINEAR ? dot(p - layer.p0, d) / max(dot(d, d), 1e-12)
+                                             : length(p - layer.p0) / max(length(d), 1e-6);
+  return mix(layer.color0, layer.color1, clamp(t, 0.0, 1.0));
+}
 
 void main()
 {
-  ivec2 uv = ivec2(gl_GlobalInvocationID.xy);
+  ivec2 size       = imageSize(image);
+  ivec2 tile_id    = counter_buffer.counters.reconstruct_origin + ivec2(gl_WorkGroupID.xy);
+  uint  tile_index = dirty_tile_count > 0 ? dirty_tile_buffer.dirty_tiles[gl_WorkGroupID.x]
+                                          : tile_id.y * tile_count.x + tile_id.x;
+  tile_id          = ivec2(tile_index % tile_count.x, tile_index / tile_count.x);
+  ivec2 uv         = tile_id * TILE_SIZE + ivec2(gl_LocalInvocationID.xy);
 
-  if (uv.x < 200 && uv.y < 200)
+  // the whole workgroup takes the same branches
+  vec4 color;
+  if ((flags & FLAG_COMPOSITE) != 0)
   {
-    imageStore(image, uv, vec4(1.0));  
+    // premultiplied source over, back to front over opaque black
+    TileLayers list = tile_layer_buffer.tile_layers[tile_index];
+    sort_layers(list.offset, list.count);
+    color = vec4(0.0, 0.0, 0.0, 1.0);
+    for (uint i = 0; i < list.count; ++i)
+    {
+      uint  layer_tile = layer_list_buffer.layer_list[list.offset + i];
+      Layer layer      = layer_buffer.layers[find_layer(LAYER_TILE, layer_tile)];
+      uint  offset     = layer_tile - layer.first_tile;
+      ivec2 local      = ivec2(offset % layer.tile_extent.x, offset / layer.tile_extent.x);
+      float coverage   = get_coverage(tile_buffer.tiles[layer_tile].block, from_backdrop(backdrop_buffer.backdrops[get_backdrop_index(layer, local)]));
+      vec4  paint      = get_paint(layer, vec2(uv) + 0.5);
+      float alpha      = paint.a * coverage;
+      color = vec4(paint.rgb * alpha, alpha) + color * (1.0 - alpha);
+    }
   }
-}
\ No newline at end of file
+  else
+  {
+    // without layers the tiles are those of the image,
+    // retained backdrops outlive the frame, the others are the suffix sums of this one
+    BackdropBuffer backdrops = (flags & FLAG_RETAINED) != 0 ? tile_backdrop_buffer : backdrop_buffer;
+    float backdrop = from_backdrop(backdrops.backdrops[tile_id.y * (tile_count.x + 1) + tile_id.x]);
+    color = vec4(vec3(get_coverage(tile_buffer.tiles[tile_index].block, backdrop)), 1.0);
+  }
+
+  if (srgb)
+    color.rgb = mix(1.055 * pow(color.rgb, vec3(1.0 / 2.4)) - 0.055, color.rgb * 12.92, lessThanEqual(color.rgb, vec3(0.0031308)));
+  if (uv.x < size.x && uv.y < size.y)
+    imageStore(image, uv, color);
+}
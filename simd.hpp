@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+//
+// lanes of floats for the cpu side loops, avx2 where the including file is
+// built with it (WAVELET_AVX2), neon on arm64 and a single lane otherwise,
+// Lanes holds lane_count floats and Mask one flag per lane, to_bits has the
+// flag of lane i in bit i
+//
+
+#if defined(__AVX2__)
+
+constexpr int lane_count = 8;
+
+struct Lanes { __m256 v; };
+struct Mask  { __m256 v; };
+
+inline Lanes splat(float f)               { return { _mm256_set1_ps(f) }; }
+inline Lanes lane_index()                 { return { _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f) }; }
+inline Lanes operator+(Lanes a, Lanes b)  { return { _mm256_add_ps(a.v, b.v) }; }
+inline Lanes operator-(Lanes a, Lanes b)  { return { _mm256_sub_ps(a.v, b.v) }; }
+inline Lanes operator*(Lanes a, Lanes b)  { return { _mm256_mul_ps(a.v, b.v) }; }
+inline Lanes operator/(Lanes a, Lanes b)  { return { _mm256_div_ps(a.v, b.v) }; }
+inline Lanes min(Lanes a, Lanes b)        { return { _mm256_min_ps(a.v, b.v) }; }
+inline Lanes max(Lanes a, Lanes b)        { return { _mm256_max_ps(a.v, b.v) }; }
+inline Mask  operator<(Lanes a, Lanes b)  { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+inline Mask  operator>(Lanes a, Lanes b)  { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+inline Mask  operator==(Lanes a, Lanes b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ) }; }
+inline Mask  operator&(Mask a, Mask b)    { return { _mm256_and_ps(a.v, b.v) }; }
+inline Mask  operator|(Mask a, Mask b)    { return { _mm256_or_ps(a.v, b.v) }; }
+inline Mask  operator!(Mask a)            { return { _mm256_xor_ps(a.v, _mm256_castsi256_ps(_mm256_set1_epi32(-1))) }; }
+inline Lanes select(Mask m, Lanes a, Lanes b) { return { _mm256_blendv_ps(b.v, a.v, m.v) }; }
+inline Lanes load(float const* p)         { return { _mm256_loadu_ps(p) }; }
+inline void  store(float* p, Lanes a)     { _mm256_storeu_ps(p, a.v); }
+inline int   to_bits(Mask m)              { return _mm256_movemask_ps(m.v); }
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+constexpr int lane_count = 4;
+
+struct Lanes { float32x4_t v; };
+struct Mask  { uint32x4_t  v; };
+
+inline Lanes splat(float f)               { return { vdupq_n_f32(f) }; }
+inline Lanes lane_index()                 { float const i[] = { 0.f, 1.f, 2.f, 3.f }; return { vld1q_f32(i) }; }
+inline Lanes operator+(Lanes a, Lanes b)  { return { vaddq_f32(a.v, b.v) }; }
+inline Lanes operator-(Lanes a, Lanes b)  { return { vsubq_f32(a.v, b.v) }; }
+inline Lanes operator*(Lanes a, Lanes b)  { return { vmulq_f32(a.v, b.v) }; }
+inline Lanes operator/(Lanes a, Lanes b)  { return { vdivq_f32(a.v, b.v) }; }
+inline Lanes min(Lanes a, Lanes b)        { return { vminq_f32(a.v, b.v) }; }
+inline Lanes max(Lanes a, Lanes b)        { return { vmaxq_f32(a.v, b.v) }; }
+inline Mask  operator<(Lanes a, Lanes b)  { return { vcltq_f32(a.v, b.v) }; }
+inline Mask  operator>(Lanes a, Lanes b)  { return { vcgtq_f32(a.v, b.v) }; }
+inline Mask  operator==(Lanes a, Lanes b) { return { vceqq_f32(a.v, b.v) }; }
+inline Mask  operator&(Mask a, Mask b)    { return { vandq_u32(a.v, b.v) }; }
+inline Mask  operator|(Mask a, Mask b)    { return { vorrq_u32(a.v, b.v) }; }
+inline Mask  operator!(Mask a)            { return { vmvnq_u32(a.v) }; }
+inline Lanes select(Mask m, Lanes a, Lanes b) { return { vbslq_f32(m.v, a.v, b.v) }; }
+inline Lanes load(float const* p)         { return { vld1q_f32(p) }; }
+inline void  store(float* p, Lanes a)     { vst1q_f32(p, a.v); }
+inline int   to_bits(Mask m)              { uint32_t const b[] = { 1, 2, 4, 8 }; return static_cast<int>(vaddvq_u32(vandq_u32(m.v, vld1q_u32(b)))); }
+
+#else
+
+constexpr int lane_count = 1;
+
+struct Lanes { float v; };
+struct Mask  { bool  v; };
+
+inline Lanes splat(float f)               { return { f }; }
+inline Lanes lane_index()                 { return { 0.f }; }
+inline Lanes operator+(Lanes a, Lanes b)  { return { a.v + b.v }; }
+inline Lanes operator-(Lanes a, Lanes b)  { return { a.v - b.v }; }
+inline Lanes operator*(Lanes a, Lanes b)  { return { a.v * b.v }; }
+inline Lanes operator/(Lanes a, Lanes b)  { return { a.v / b.v }; }
+inline Lanes min(Lanes a, Lanes b)        { return { std::min(a.v, b.v) }; }
+inline Lanes max(Lanes a, Lanes b)        { return { std::max(a.v, b.v) }; }
+inline Mask  operator<(Lanes a, Lanes b)  { return { a.v < b.v }; }
+inline Mask  operator>(Lanes a, Lanes b)  { return { a.v > b.v }; }
+inline Mask  operator==(Lanes a, Lanes b) { return { a.v == b.v }; }
+inline Mask  operator&(Mask a, Mask b)    { return { a.v && b.v }; }
+inline Mask  operator|(Mask a, Mask b)    { return { a.v || b.v }; }
+inline Mask  operator!(Mask a)            { return { !a.v }; }
+inline Lanes select(Mask m, Lanes a, Lanes b) { return { m.v ? a.v : b.v }; }
+inline Lanes load(float const* p)         { return { *p }; }
+inline void  store(float* p, Lanes a)     { *p = a.v; }
+inline int   to_bits(Mask m)              { return m.v; }
+
+#endif
@@ -0,0 +1,269 @@
+#include "tiled_export.hpp"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+////////////////////////////////////////////////////////////////////////////////
+//                              image writer
+////////////////////////////////////////////////////////////////////////////////
+
+// 8 bit coverage file, tiles arrive in row major order, which is also the
+// order of the tiles in a tiff
+class ImageWriter
+{
+public:
+  ImageWriter(std::filesystem::path const& path, VkExtent2D extent, uint32_t tile_extent);
+  ~ImageWriter();
+
+  ImageWriter(ImageWriter const&)            = delete;
+  ImageWriter& operator=(ImageWriter const&) = delete;
+
+  // tile_extent x tile_extent pixels, raw files crop the part outside the extent
+  void write_tile(glm::uvec2 tile, uint8_t const* pixels);
+
+private:
+  template <typename T>
+  void put(T value)
+  {
+    m_file.write(reinterpret_cast<char const*>(&value), sizeof(value));
+  }
+  void write_directory();
+
+  std::ofstream         m_file;
+  VkExtent2D            m_extent;
+  uint32_t              m_tile_extent;
+  bool                  m_tiff;
+  std::vector<uint64_t> m_tile_offsets;
+};
+
+// bigtiff is written in host byte order
+static_assert(std::endian::native == std::endian::little, "tiff header says little endian");
+
+ImageWriter::ImageWriter(std::filesystem::path const& path, VkExtent2D extent, uint32_t tile_extent)
+  : m_file(path, std::ios::binary | std::ios::trunc),
+    m_extent(extent),
+    m_tile_extent(tile_extent)
+{
+  exit_if(!m_file.is_open());
+  auto extension = path.extension();
+  m_tiff = extension == ".tif" || extension == ".tiff";
+  if (!m_tiff)
+    return;
+
+  // bigtiff header, the offset of the directory is patched in at the end
+  m_file.write("II", 2);
+  put<uint16_t>(43);
+  put<uint16_t>(8);
+  put<uint16_t>(0);
+  put<uint64_t>(0);
+}
+
+ImageWriter::~ImageWriter()
+{
+  if (m_tiff)
+    write_directory();
+  m_file.close();
+  exit_if(!m_file);
+}
+
+void ImageWriter::write_tile(glm::uvec2 tile, uint8_t const* pixels)
+{
+  auto tile_bytes = static_cast<size_t>(m_tile_extent) * m_tile_extent;
+  if (m_tiff)
+  {
+    // border tiles keep their padding, readers crop it
+    m_tile_offsets.push_back(static_cast<uint64_t>(m_file.tellp()));
+    m_file.write(reinterpret_cast<char const*>(pixels), tile_bytes);
+    return;
+  }
+
+  // the rows of a tile are apart by the output width
+  auto origin = tile * m_tile_extent;
+  auto width  = std::min(m_tile_extent, m_extent.width - origin.x);
+  auto height = std::min(m_tile_extent, m_extent.height - origin.y);
+  for (uint32_t y = 0; y < height; ++y)
+  {
+    m_file.seekp(static_cast<std::streamoff>(static_cast<uint64_t>(origin.y + y) * m_extent.width + origin.x));
+    m_file.write(reinterpret_cast<char const*>(pixels + static_cast<size_t>(y) * m_tile_extent), width);
+  }
+}
+
+void ImageWriter::write_directory()
+{
+  constexpr uint16_t type_short = 3;
+  constexpr uint16_t type_long  = 4;
+  constexpr uint16_t type_long8 = 16;
+
+  // arrays of more than one value live outside the directory entries
+  auto tile_count = m_tile_offsets.size();
+  auto tile_bytes = static_cast<uint64_t>(m_tile_extent) * m_tile_extent;
+  auto offsets    = static_cast<uint64_t>(m_file.tellp());
+  for (auto offset : m_tile_offsets)
+    put(offset);
+  auto byte_counts = static_cast<uint64_t>(m_file.tellp());
+  for (size_t i = 0; i < tile_count; ++i)
+    put(tile_bytes);
+
+  struct Entry
+  {
+    uint16_t tag;
+    uint16_t type;
+    uint64_t count;
+    uint64_t value;
+  };
+  auto single = tile_count == 1;
+  Entry entries[] =
+  {
+    { 256, type_long,  1,          m_extent.width },                       // image width
+    { 257, type_long,  1,          m_extent.height },                      // image length
+    { 258, type_short, 1,          8 },                                    // bits per sample
+    { 259, type_short, 1,          1 },                                    // no compression
+    { 262, type_short, 1,          1 },                                    // black is zero
+    { 277, type_short, 1,          1 },                                    // samples per pixel
+    { 322, type_long,  1,          m_tile_extent },                        // tile width
+    { 323, type_long,  1,          m_tile_extent },                        // tile length
+    { 324, type_long8, tile_count, single ? m_tile_offsets[0] : offsets }, // tile offsets
+    { 325, type_long8, tile_count, single ? tile_bytes : byte_counts },    // tile byte counts
+  };
+  auto directory = static_cast<uint64_t>(m_file.tellp());
+  put<uint64_t>(std::size(entries));
+  for (auto const& entry : entries)
+  {
+    put(entry.tag);
+    put(entry.type);
+    put(entry.count);
+    put(entry.value);
+  }
+  // no next directory
+  put<uint64_t>(0);
+
+  m_file.seekp(8);
+  put(directory);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                              funcs
+////////////////////////////////////////////////////////////////////////////////
+
+// add_bezier splits edges at their extrema, so the end points bound them
+auto get_bounds(Edge const& edge)
+{
+  auto end = get_end(edge);
+  return std::pair(glm::min(edge.p0, end), glm::max(edge.p0, end));
+}
+
+// the edges of the band reaching the tile at origin into g_edges in tile coordinates,
+// an edge right of the tile only adds its height to the backdrops, so it becomes a
+// line on the right border, consecutive border lines add up to one
+void cull_edges(std::span<Edge const> band, glm::vec2 origin, float size)
+{
+  g_edges.clear();
+  auto border = false;
+  for (auto const& edge : band)
+  {
+    auto [min, max] = get_bounds(edge);
+    if (max.x <= origin.x)
+      continue;
+    if (min.x >= origin.x + size)
+    {
+      auto beg = edge.p0.y - origin.y;
+      auto end = get_end(edge).y - origin.y;
+      if (border && g_edges.back().p1.y == beg)
+        g_edges.back().p1.y = end;
+      else
+        add_line({ size, beg }, { size, end });
+      border = true;
+      continue;
+    }
+
+    auto local = edge;
+    local.p0  -= origin;
+    local.p1  -= origin;
+    local.p2  -= origin;
+    local.p3  -= origin;
+    g_edges.push_back(local);
+    border = false;
+  }
+}
+
+// 8 bit coverage of the readback, every format keeps it in the first channel
+void get_coverage(void const* data, std::span<uint8_t> pixels)
+{
+  auto to_byte = [](float value) { return static_cast<uint8_t>(std::clamp(value, 0.f, 1.f) * 255.f + .5f); };
+  switch (g_wr_image.format)
+  {
+  case VK_FORMAT_R8_UNORM:
+    std::memcpy(pixels.data(), data, pixels.size());
+    break;
+  case VK_FORMAT_R16_SFLOAT:
+    for (size_t i = 0; i < pixels.size(); ++i)
+      pixels[i] = to_byte(glm::unpackHalf1x16(static_cast<uint16_t const*>(data)[i]));
+    break;
+  case VK_FORMAT_R8G8B8A8_UNORM:
+    for (size_t i = 0; i < pixels.size(); ++i)
+      pixels[i] = static_cast<uint8_t const*>(data)[i * 4];
+    break;
+  default:
+    for (size_t i = 0; i < pixels.size(); ++i)
+      pixels[i] = to_byte(static_cast<float const*>(data)[i * 4]);
+  }
+}
+
+void export_tiled(std::filesystem::path const& path, std::span<Edge const> edges, VkExtent2D extent, uint32_t tile_extent)
+{
+  exit_if(g_windowed || g_retained || !tile_extent || tile_extent % tile_size);
+
+  // g_wr_image is a single tile
+  if (g_wr_image.extent.width != tile_extent || g_wr_image.extent.height != tile_extent)
+  {
+    release_scene_resources();
+    create_scene_resources({ tile_extent, tile_extent });
+  }
+
+  // two readbacks, one is written to disk while the gpu renders and copies the next tile
+  ImageWriter writer(path, extent, tile_extent);
+  std::array readbacks = { create_readback(), create_readback() };
+  std::vector<uint8_t> pixels(static_cast<size_t>(tile_extent) * tile_extent);
+  auto tile_count = glm::uvec2((extent.width + tile_extent - 1) / tile_extent, (extent.height + tile_extent - 1) / tile_extent);
+  auto write = [&](uint32_t index)
+  {
+    auto& readback = readbacks[index % readbacks.size()];
+    wait_readback(readback);
+    get_coverage(readback.data, pixels);
+    writer.write_tile({ index % tile_count.x, index / tile_count.x }, pixels.data());
+  };
+
+  std::vector<Edge> band;
+  for (uint32_t row = 0; row < tile_count.y; ++row)
+  {
+    // the edges reaching into the row of tiles, every tile of the row picks its edges from them
+    auto top    = static_cast<float>(row) * tile_extent;
+    auto bottom = top + tile_extent;
+    band.clear();
+    std::ranges::copy_if(edges, std::back_inserter(band), [&](Edge const& edge)
+    {
+      auto [min, max] = get_bounds(edge);
+      return max.y > top && min.y < bottom;
+    });
+
+    for (uint32_t col = 0; col < tile_count.x; ++col)
+    {
+      auto index = row * tile_count.x + col;
+      cull_edges(band, glm::vec2(col, row) * static_cast<float>(tile_extent), static_cast<float>(tile_extent));
+      update_scene();
+      render_headless();
+      submit_readback(readbacks[index % readbacks.size()]);
+      if (index)
+        write(index - 1);
+    }
+  }
+  write(tile_count.x * tile_count.y - 1);
+
+  for (auto& readback : readbacks)
+    destroy_readback(readback);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "renderer.hpp"
+
+#include <span>
+#include <filesystem>
+
+//
+// out of core export of scenes larger than any image the device can hold,
+// g_wr_image is one tile of the output and the tiles are rasterized one
+// after another in row major order, each from the edges overlapping it
+//
+// a tile is read back while the next one renders and is then written to
+// disk right away, so host memory holds the edges and a few tiles however
+// large the output is
+//
+// the output is 8 bit coverage, either raw rows without header or a tiled
+// uncompressed bigtiff (.tif, .tiff), which readers need for outputs past 4 gb
+//
+
+// headless only and not retained, tile_extent is a multiple of tile_size, the scene
+// resources are recreated for the tile and g_edges holds the edges of the last tile
+void export_tiled(std::filesystem::path const& path, std::span<Edge const> edges, VkExtent2D extent, uint32_t tile_extent);
@@ -0,0 +1,203 @@
+//
+// Analytic Haar wavelet coefficients of edges, see Manson and Schaefer,
+// "Wavelet Rasterization". Every function works in the local coordinates
+// of one quadtree cell, where the cell is the unit square.
+//
+// For a cell with quadrants of coverage A00 (top left), A10 (top right),
+// A01 (bottom left) and A11 (bottom right) the scaling coefficient is the
+// mean coverage c and the detail coefficients are
+//
+//   dx  = (A00 - A10 + A01 - A11) / 4
+//   dy  = (A00 + A10 - A01 - A11) / 4
+//   dxy = (A00 - A10 - A01 + A11) / 4
+//
+// All of them are area integrals over the shape, which the divergence
+// theorem turns into integrals along the edges clipped to the cell.
+//
+// Edges are lines or quadratic/cubic Bezier segments. Curves are split
+// into x and y monotone pieces on the host, so every clip or split line
+// crosses a piece at most once and the integrands stay polynomials that
+// Gauss-Legendre quadrature integrates exactly.
+//
+
+// clip segment to the unit square, returns false when nothing is left
+bool clip(inout vec2 p0, inout vec2 p1)
+{
+  vec2 d    = p1 - p0;
+  float t0  = 0.0;
+  float t1  = 1.0;
+  float p[4] = { -d.x, d.x, -d.y, d.y };
+  float q[4] = { p0.x, 1.0 - p0.x, p0.y, 1.0 - p0.y };
+  for (int i = 0; i < 4; ++i)
+  {
+    if (p[i] == 0.0)
+    {
+      if (q[i] < 0.0) return false;
+    }
+    else
+    {
+      float t = q[i] / p[i];
+      if (p[i] < 0.0) t0 = max(t0, t);
+      else            t1 = min(t1, t);
+    }
+  }
+  if (t0 >= t1) return false;
+  vec2 beg = p0 + t0 * d;
+  p1       = p0 + t1 * d;
+  p0       = beg;
+  return true;
+}
+
+float tent(float t)
+{
+  return t < 0.5 ? t : 1.0 - t;
+}
+
+// scaling coefficient of a cell, the integral of clamp(x, 0, 1) dy
+// over the segment restricted to 0 <= y <= 1
+float scaling_coefficient(vec2 p0, vec2 p1)
+{
+  vec2 d = p1 - p0;
+  if (d.y == 0.0) return 0.0;
+
+  // restrict to 0 <= y <= 1
+  float t0 = clamp((0.0 - p0.y) / d.y, 0.0, 1.0);
+  float t1 = clamp((1.0 - p0.y) / d.y, 0.0, 1.0);
+  if (t0 > t1)
+  {
+    float t = t0; t0 = t1; t1 = t;
+  }
+
+  // split at x = 0 and x = 1, the integrand is linear on every piece
+  float ts[4] = { t0, t0, t1, t1 };
+  if (d.x != 0.0)
+  {
+    float a = clamp((0.0 - p0.x) / d.x, t0, t1);
+    float b = clamp((1.0 - p0.x) / d.x, t0, t1);
+    ts[1] = min(a, b);
+    ts[2] = max(a, b);
+  }
+
+  float c = 0.0;
+  for (int i = 0; i < 3; ++i)
+  {
+    vec2 q0 = p0 + ts[i] * d;
+    vec2 q1 = p0 + ts[i + 1] * d;
+    c += (q1.y - q0.y) * clamp(0.5 * (q0.x + q1.x), 0.0, 1.0);
+  }
+  return c;
+}
+
+// detail coefficients (dx, dy, dxy) of a segment given in the local
+// coordinates of a cell, the segment must already be clipped to the cell
+vec3 wavelet_coefficients(vec2 p0, vec2 p1)
+{
+  // split at the cell center lines, every piece lies in one quadrant
+  vec2 d = p1 - p0;
+  float tx = d.x != 0.0 ? clamp((0.5 - p0.x) / d.x, 0.0, 1.0) : 0.0;
+  float ty = d.y != 0.0 ? clamp((0.5 - p0.y) / d.y, 0.0, 1.0) : 0.0;
+  float ts[4] = { 0.0, min(tx, ty), max(tx, ty), 1.0 };
+
+  vec3 c = vec3(0.0);
+  for (int i = 0; i < 3; ++i)
+  {
+    vec2 q0 = p0 + ts[i] * d;
+    vec2 q1 = p0 + ts[i + 1] * d;
+    vec2 m  = 0.5 * (q0 + q1);
+    float sy = m.y < 0.5 ? 1.0 : -1.0;
+    // the tent is linear on a piece, so its integral is exact at the midpoint
+    c.x += (q1.y - q0.y) * tent(m.x);
+    c.y -= (q1.x - q0.x) * tent(m.y);
+    c.z += (q1.y - q0.y) * tent(m.x) * sy;
+  }
+  return c;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                              curves
+////////////////////////////////////////////////////////////////////////////////
+
+// parameters where the curve crosses the lines x = values[i] or y = values[i]
+// plus both end points, sorted ascending
+int breakpoints(Poly p, vec3 values, int value_count, out float ts[8])
+{
+  int count = 0;
+  ts[count++] = 0.0;
+  for (int axis = 0; axis < 2; ++axis)
+    for (int i = 0; i < value_count; ++i)
+    {
+      float t = solve(p, axis, values[i]);
+      if (t > 0.0) ts[count++] = t;
+    }
+  ts[count++] = 1.0;
+
+  for (int i = 1; i < count; ++i)
+  {
+    float t = ts[i];
+    int   j = i - 1;
+    for (; j >= 0 && ts[j] > t; --j)
+      ts[j + 1] = ts[j];
+    ts[j + 1] = t;
+  }
+  return count;
+}
+
+// 3 point Gauss-Legendre on [0, 1], exact up to degree 5
+const float gauss_nodes[3]   = { 0.1127016654, 0.5, 0.8872983346 };
+const float gauss_weights[3] = { 0.2777777778, 0.4444444444, 0.2777777778 };
+
+float curve_scaling_coefficient(Poly p)
+{
+  float ts[8];
+  int count = breakpoints(p, vec3(0.0, 1.0, 0.0), 2, ts);
+
+  float c = 0.0;
+  for (int i = 0; i + 1 < count; ++i)
+  {
+    float dt = ts[i + 1] - ts[i];
+    vec2  m  = evaluate(p, ts[i] + 0.5 * dt);
+    if (dt <= 0.0 || m.y < 0.0 || m.y > 1.0 || m.x < 0.0) continue;
+
+    // clamp(x, 0, 1) is either x or 1 on a piece
+    for (int k = 0; k < 3; ++k)
+    {
+      float t = ts[i] + gauss_nodes[k] * dt;
+      float x = m.x > 1.0 ? 1.0 : evaluate(p, t).x;
+      c += gauss_weights[k] * dt * x * derivative(p, t).y;
+    }
+  }
+  return c;
+}
+
+// detail coefficients of a curve given in the local coordinates of a cell,
+// returns false when the curve misses the cell
+bool curve_wavelet_coefficients(Poly p, out vec3 c)
+{
+  float ts[8];
+  int count = breakpoints(p, vec3(0.0, 0.5, 1.0), 3, ts);
+
+  c = vec3(0.0);
+  bool hit = false;
+  for (int i = 0; i + 1 < count; ++i)
+  {
+    float dt = ts[i + 1] - ts[i];
+    vec2  m  = evaluate(p, ts[i] + 0.5 * dt);
+    if (dt <= 0.0 || any(lessThan(m, vec2(0.0))) || any(greaterThan(m, vec2(1.0)))) continue;
+    hit = true;
+
+    // the piece stays in one quadrant, so the tents are linear on it
+    float sy = m.y < 0.5 ? 1.0 : -1.0;
+    for (int k = 0; k < 3; ++k)
+    {
+      float t  = ts[i] + gauss_nodes[k] * dt;
+      vec2  q  = evaluate(p, t);
+      vec2  d  = derivative(p, t) * gauss_weights[k] * dt;
+      float tx = m.x < 0.5 ? q.x : 1.0 - q.x;
+      float ty = m.y < 0.5 ? q.y : 1.0 - q.y;
+      c.x += tx * d.y;
+      c.y -= ty * d.x;
+      c.z += tx * d.y * sy;
+    }
+  }
+  return hit;
+}